@@ -0,0 +1,165 @@
+/* datagram_pps.cpp -- v1.0
+   Measures 64-byte datagram echo rates of DatagramServer at 1-16 workers */
+
+#include "fserv/datagram_server.hpp"
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Datagram size (bytes)
+    constexpr int kDatagramSize = 64;
+    // Number of sender sockets, spread across the workers by the kernel
+    constexpr int kSocketCount = 16;
+    // Datagrams in flight per sender socket
+    constexpr int kWindow = 64;
+    // Time after which datagrams in flight on a socket count as lost
+    constexpr std::chrono::milliseconds kLossTimeout(20);
+    // Length of each run
+    constexpr std::chrono::seconds kDuration(2);
+    // First listening port, one per run
+    constexpr int kFirstPort = 9491;
+
+    //! @struct Sender
+    /*! Sender socket and its datagrams in flight
+     */
+    struct Sender {
+        int sfd = -1;
+        int in_flight = 0;
+        Clock::time_point progress;
+    };
+
+    //! @brief Echoes datagrams through a server with worker_count workers,
+    //!        returning the replies received per second
+    double run(int worker_count, int port, std::uint64_t* dropped)
+    {
+        fserv::DatagramServer server;
+        server.bind_datagram_received_callback(
+            [](fserv::DatagramSession& session, const char* data, int size) {
+                session.reply(data, size);
+            });
+
+        if (!server.bind(port)) {
+            return -1;
+        }
+
+        std::thread runner([&server, worker_count] {
+            server.run(worker_count);
+        });
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        std::vector<Sender> senders(kSocketCount);
+        for (Sender& sender: senders) {
+            sender.sfd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+            ::connect(sender.sfd,
+                      reinterpret_cast<const sockaddr*>(&addr),
+                      sizeof(addr));
+        }
+
+        // One batch of datagrams, sent and received on connected sockets
+        char buffers[kWindow][kDatagramSize] = {};
+        iovec iovs[kWindow];
+        mmsghdr msgs[kWindow] = {};
+        for (int i = 0; i != kWindow; ++i) {
+            iovs[i].iov_base = buffers[i];
+            iovs[i].iov_len = kDatagramSize;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        // Let the workers start
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        std::vector<pollfd> fds(kSocketCount);
+        for (int i = 0; i != kSocketCount; ++i) {
+            fds[i].fd = senders[i].sfd;
+            fds[i].events = POLLIN;
+        }
+
+        std::uint64_t replies = 0;
+        const auto start = Clock::now();
+        for (auto now = start; now - start < kDuration; now = Clock::now()) {
+            // Waiting leaves the CPU to the workers
+            ::poll(fds.data(), kSocketCount, 1);
+
+            for (Sender& sender: senders) {
+                if (sender.in_flight != 0
+                    && now - sender.progress > kLossTimeout) {
+                    sender.in_flight = 0;
+                }
+
+                if (sender.in_flight < kWindow) {
+                    const int n = ::sendmmsg(
+                        sender.sfd, msgs, kWindow - sender.in_flight, 0);
+                    if (n > 0) {
+                        sender.in_flight += n;
+                        sender.progress = now;
+                    }
+                }
+
+                const int n = ::recvmmsg(
+                    sender.sfd, msgs, kWindow, MSG_DONTWAIT, nullptr);
+                if (n > 0) {
+                    replies += n;
+                    sender.in_flight -= n < sender.in_flight
+                                            ? n
+                                            : sender.in_flight;
+                    sender.progress = now;
+                }
+            }
+        }
+
+        const double s
+            = std::chrono::duration<double>(Clock::now() - start).count();
+
+        for (const Sender& sender: senders) {
+            ::close(sender.sfd);
+        }
+
+        server.stop();
+        runner.join();
+
+        *dropped = server.metrics().dropped_count;
+        return replies / s;
+    }
+} // namespace
+
+int main()
+{
+    std::printf("%d B datagrams echoed, %d sender sockets with up to %d "
+                "datagrams in flight each, %lld s per run, %u CPUs\n",
+                kDatagramSize,
+                kSocketCount,
+                kWindow,
+                static_cast<long long>(kDuration.count()),
+                std::thread::hardware_concurrency());
+
+    int port = kFirstPort;
+    for (const int worker_count: {1, 2, 4, 8, 16}) {
+        std::uint64_t dropped = 0;
+        const double pps = run(worker_count, port++, &dropped);
+        if (pps < 0) {
+            std::printf("%2d workers: bind failed\n", worker_count);
+            continue;
+        }
+
+        std::printf("%2d workers: %8.0f pps, %llu replies dropped\n",
+                    worker_count,
+                    pps,
+                    static_cast<unsigned long long>(dropped));
+    }
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+/* read_buffer.cpp -- v1.0
+   Frames a message stream read through a mirrored ring and through a deque
+   of chunks */
+
+#include "fserv/framing.hpp"
+#include "fserv/mirrored_ring.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace {
+    // Size of the generated stream
+    constexpr int kStreamSize = 64 * 1024 * 1024;
+    // Size of each simulated read
+    constexpr int kReadSize = 4096;
+    // Capacity of the mirrored ring
+    constexpr int kRingSize = 64 * 1024;
+    // Runs of each reader
+    constexpr int kRuns = 5;
+
+    //! @brief Builds a stream of 4-byte length-prefixed messages of
+    //!        100-3100 bytes, returning the number of messages
+    int make_stream(std::vector<char>& stream)
+    {
+        std::mt19937 rng(1);
+        int count = 0;
+
+        while (true) {
+            const int size = 100 + static_cast<int>(rng() % 3001);
+            if (stream.size() + 4 + size > kStreamSize) {
+                return count;
+            }
+
+            for (int shift = 24; shift >= 0; shift -= 8) {
+                stream.push_back(static_cast<char>(size >> shift));
+            }
+
+            stream.resize(stream.size() + size, static_cast<char>(count));
+            ++count;
+        }
+    }
+
+    //! @brief Reads the stream into a mirrored ring and frames the readable
+    //!        span in place, returning the number of messages
+    int read_ring(const std::vector<char>& stream, std::uint64_t* checksum)
+    {
+        const fserv::AnyFramer framer = fserv::LengthPrefixFramer(4);
+        fserv::util::MirroredRing ring;
+        if (!fserv::util::init(ring, kRingSize)) {
+            return -1;
+        }
+
+        int count = 0;
+        int scanned = 0;
+        const auto on_message = [&](const char* data, int size) {
+            *checksum += static_cast<unsigned char>(data[size - 1]);
+            ++count;
+            return true;
+        };
+
+        for (std::size_t offset = 0; offset != stream.size();) {
+            int n = static_cast<int>(stream.size() - offset);
+            n = n < kReadSize ? n : kReadSize;
+
+            std::memcpy(fserv::util::write_ptr(ring), &stream[offset], n);
+            fserv::util::commit(ring, n);
+            offset += n;
+
+            bool proceed = true;
+            const int consumed = fserv::FrameAssembler::consume(
+                framer,
+                fserv::util::read_ptr(ring),
+                fserv::util::readable_size(ring),
+                on_message,
+                &proceed,
+                &scanned);
+            fserv::util::consume(ring, consumed);
+        }
+
+        fserv::util::destroy(ring);
+        return count;
+    }
+
+    //! @brief Reads the stream into a deque of fixed-size chunks, handing
+    //!        out messages held by one chunk in place and copying out those
+    //!        straddling chunks, returning the number of messages
+    int read_chunks(const std::vector<char>& stream, std::uint64_t* checksum)
+    {
+        std::deque<std::vector<char>> chunks;
+        std::vector<std::vector<char>> spare;
+        std::vector<char> straddling;
+        // Offset of the first unframed byte in the front chunk
+        int head = 0;
+        // Number of unframed bytes
+        int buffered = 0;
+        int count = 0;
+
+        const auto copy_out = [&](char* buff, int size) {
+            int chunk = 0;
+            int offset = head;
+            while (size > 0) {
+                const std::vector<char>& c = chunks[chunk];
+                int n = static_cast<int>(c.size()) - offset;
+                n = n < size ? n : size;
+                std::memcpy(buff, c.data() + offset, n);
+                buff += n;
+                size -= n;
+                ++chunk;
+                offset = 0;
+            }
+        };
+
+        const auto drop = [&](int size) {
+            buffered -= size;
+            head += size;
+            while (!chunks.empty()
+                   && head >= static_cast<int>(chunks.front().size())) {
+                head -= static_cast<int>(chunks.front().size());
+                spare.push_back(std::move(chunks.front()));
+                chunks.pop_front();
+            }
+        };
+
+        for (std::size_t offset = 0; offset != stream.size();) {
+            int n = static_cast<int>(stream.size() - offset);
+            n = n < kReadSize ? n : kReadSize;
+
+            std::vector<char> chunk;
+            if (!spare.empty()) {
+                chunk = std::move(spare.back());
+                spare.pop_back();
+            }
+
+            chunk.assign(&stream[offset], &stream[offset] + n);
+            chunks.push_back(std::move(chunk));
+            buffered += n;
+            offset += n;
+
+            while (buffered >= 4) {
+                unsigned char header[4];
+                copy_out(reinterpret_cast<char*>(header), 4);
+                const int size = (header[0] << 24) | (header[1] << 16)
+                                 | (header[2] << 8) | header[3];
+                if (buffered < 4 + size) {
+                    break;
+                }
+
+                const std::vector<char>& front = chunks.front();
+                const char* message = nullptr;
+                if (head + 4 + size <= static_cast<int>(front.size())) {
+                    message = front.data() + head + 4;
+                } else {
+                    straddling.resize(4 + size);
+                    copy_out(straddling.data(), 4 + size);
+                    message = straddling.data() + 4;
+                }
+
+                *checksum += static_cast<unsigned char>(message[size - 1]);
+                ++count;
+                drop(4 + size);
+            }
+        }
+
+        return count;
+    }
+
+    //! @brief Runs reader over the stream and prints its rate
+    template <typename ReaderType>
+    void run(const char* name,
+             const std::vector<char>& stream,
+             int expected,
+             ReaderType&& reader)
+    {
+        for (int run = 0; run != kRuns; ++run) {
+            std::uint64_t checksum = 0;
+            const auto start = std::chrono::steady_clock::now();
+            const int count = reader(stream, &checksum);
+            const double s = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+
+            std::printf("%-16s %5.2f Mmsg/s %5.2f GB/s%s (checksum %llu)\n",
+                        name,
+                        count / s / 1e6,
+                        stream.size() / s / 1e9,
+                        count == expected ? "" : " MISMATCH",
+                        static_cast<unsigned long long>(checksum));
+        }
+    }
+} // namespace
+
+int main()
+{
+    std::vector<char> stream;
+    stream.reserve(kStreamSize);
+    const int expected = make_stream(stream);
+
+    std::printf("%d messages, %zu bytes, %d-byte reads\n",
+                expected,
+                stream.size(),
+                kReadSize);
+    run("mirrored ring", stream, expected, read_ring);
+    run("deque of chunks", stream, expected, read_chunks);
+
+    return 0;
+}
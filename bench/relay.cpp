@@ -0,0 +1,206 @@
+/* relay.cpp -- v1.0
+   Measures relay throughput over loopback with ClientSession::proxy and
+   with a relay copying each read into a write to the outbound session */
+
+#include "fserv/basic_client.hpp"
+#include "fserv/basic_server.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    using Session = fserv::ClientSession<fserv::BasicClient>;
+    using Clock = std::chrono::steady_clock;
+
+    // Bytes sent through the relay on each run
+    constexpr std::int64_t kTransferSize = 1024LL * 1024 * 1024;
+    // Size of each send() and recv() of the sender and the sink
+    constexpr int kChunkSize = 256 * 1024;
+    // Runs of each mode
+    constexpr int kRuns = 3;
+    // Port of the sink the relay connects to
+    constexpr int kSinkPort = 9501;
+    // First listening port of the relay, one per run
+    constexpr int kFirstPort = 9502;
+
+    //! @struct CopyRelay
+    /*! Outbound session of the copying relay, and the bytes read before
+     *! it was connected. Used from the single worker only.
+     */
+    struct CopyRelay {
+        int client_uuid = -1;
+        std::unique_ptr<Session> upstream;
+        std::vector<char> pending;
+    };
+
+    //! @brief Accepts one connection on the sink and reads it to the end,
+    //!        returning the number of bytes read
+    std::int64_t drain(int listener)
+    {
+        const int sfd = ::accept(listener, nullptr, nullptr);
+        if (sfd == -1) {
+            return -1;
+        }
+
+        std::vector<char> buff(kChunkSize);
+        std::int64_t received = 0;
+        for (int n; (n = ::recv(sfd, buff.data(), kChunkSize, 0)) > 0;) {
+            received += n;
+            if (received == kTransferSize) {
+                break;
+            }
+        }
+
+        ::close(sfd);
+        return received;
+    }
+
+    //! @brief Connects to the relay and sends kTransferSize bytes,
+    //!        returning the socket, -1 on failure
+    int send_all(int port)
+    {
+        const int sfd = fserv::util::endpoint_tcp();
+        if (fserv::util::endpoint_connect(sfd, "127.0.0.1", port) != 0) {
+            return ::close(sfd), -1;
+        }
+
+        const std::vector<char> buff(kChunkSize, 'r');
+        for (std::int64_t sent = 0; sent < kTransferSize;) {
+            const int n = ::send(sfd, buff.data(), kChunkSize, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return ::close(sfd), -1;
+            }
+
+            sent += n;
+        }
+
+        return sfd;
+    }
+
+    //! @brief Relays kTransferSize bytes to the sink once, printing the
+    //!        throughput and the CPU time of the whole process
+    void run(bool splice, int listener, int port)
+    {
+        const char* name = splice ? "splice proxy()" : "copy read/write";
+
+        fserv::BasicServer<fserv::BasicClient> server;
+
+        // Outbound writes beyond the socket buffer wait in the queue
+        fserv::ClientOptions options;
+        options.queue_writes = true;
+        server.set_client_options(options);
+
+        CopyRelay relay;
+        server.bind_new_client_callback([&](Session& session) {
+            if (splice) {
+                session.proxy(
+                    fserv::util::endpoint_address("127.0.0.1", kSinkPort));
+                return;
+            }
+
+            relay.client_uuid = session.uuid();
+            server.connect("127.0.0.1", kSinkPort, [&](Session& up, int err) {
+                if (err != 0) {
+                    return;
+                }
+
+                relay.upstream = std::make_unique<Session>(up);
+                relay.upstream->write(relay.pending.data(),
+                                      static_cast<int>(relay.pending.size()));
+                relay.pending.clear();
+                up.rearm();
+            });
+        });
+
+        server.bind_client_data_received_callback(
+            [&relay](Session& session, const char* data, const int size) {
+                if (session.uuid() != relay.client_uuid) {
+                    return;
+                }
+
+                // Rearming the outbound session arms it for the output the
+                // write leaves queued
+                if (relay.upstream) {
+                    relay.upstream->write(data, size);
+                    relay.upstream->rearm();
+                } else {
+                    relay.pending.insert(
+                        relay.pending.end(), data, data + size);
+                }
+
+                session.rearm();
+            });
+
+        if (!server.bind(port, 16)) {
+            std::printf("%-16s bind failed\n", name);
+            return;
+        }
+
+        std::thread runner([&server] { server.run(1, 16, 0); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        const std::clock_t cpu = std::clock();
+        const auto start = Clock::now();
+
+        std::int64_t received = 0;
+        std::thread sink([&received, listener] { received = drain(listener); });
+        const int sfd = send_all(port);
+        sink.join();
+
+        // Closed only now, as a client closing is not read to the end
+        if (sfd != -1) {
+            ::close(sfd);
+        }
+
+        const double s
+            = std::chrono::duration<double>(Clock::now() - start).count();
+        const double cpu_s
+            = static_cast<double>(std::clock() - cpu) / CLOCKS_PER_SEC;
+
+        server.stop();
+        runner.join();
+
+        if (sfd == -1 || received != kTransferSize) {
+            std::printf("%-16s relayed %lld of %lld bytes\n",
+                        name,
+                        static_cast<long long>(received),
+                        static_cast<long long>(kTransferSize));
+            return;
+        }
+
+        std::printf("%-16s %5.2f GB/s  %5.2f CPU s/GB\n",
+                    name,
+                    kTransferSize / s / 1e9,
+                    cpu_s / (kTransferSize / 1e9));
+    }
+} // namespace
+
+int main()
+{
+    const int listener = fserv::util::endpoint_tcp_server(kSinkPort, 16);
+    if (listener == -1) {
+        std::printf("sink bind failed\n");
+        return 1;
+    }
+
+    std::printf("%lld MiB relayed one way per run, %d KiB sends and "
+                "receives, CPU time of sender, relay and sink together\n",
+                static_cast<long long>(kTransferSize / (1024 * 1024)),
+                kChunkSize / 1024);
+
+    int port = kFirstPort;
+    for (const bool splice: {true, false}) {
+        for (int run = 0; run != kRuns; ++run) {
+            ::run(splice, listener, port++);
+        }
+    }
+
+    ::close(listener);
+    return 0;
+}
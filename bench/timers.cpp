@@ -0,0 +1,193 @@
+/* timers.cpp -- v1.0
+   Arms, cancels and fires 1M per-session callbacks */
+
+#include "fserv/basic_client.hpp"
+#include "fserv/basic_server.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    using Session = fserv::ClientSession<fserv::BasicClient>;
+    using Clock = std::chrono::steady_clock;
+
+    // Number of callbacks armed on the session
+    constexpr int kTimerCount = 1000000;
+    // Shortest delay, the delays spreading over the next second, long
+    // enough for none to expire before all are armed
+    constexpr int kMinDelay = 4000;
+    // Listening port
+    constexpr int kPort = 9481;
+
+    // Number of allocations made by the program
+    std::atomic<long> g_allocations{0};
+    // Number of callbacks run
+    std::atomic<int> g_fired{0};
+    // Longest delay of a callback past its deadline (ns)
+    std::atomic<long long> g_max_lateness{0};
+    // Set once the accepted handler has armed the callbacks
+    std::atomic<bool> g_armed{false};
+
+    //! @brief Runs fn and prints its cost per callback
+    template <typename FnType>
+    void measure(const char* name, int count, FnType&& fn)
+    {
+        const long allocations = g_allocations.load();
+        const auto start = Clock::now();
+        fn();
+        const double ns = std::chrono::duration<double, std::nano>(
+                              Clock::now() - start)
+                              .count();
+
+        std::printf("%-8s %7d callbacks  %5.0f ns/callback  %6ld allocations\n",
+                    name,
+                    count,
+                    ns / count,
+                    g_allocations.load() - allocations);
+    }
+
+    //! @brief Arms the callbacks on an accepted session, then cancels and
+    //!        re-arms half of them
+    void arm(Session& session, bool churn)
+    {
+        static std::vector<fserv::TimerId> ids(kTimerCount);
+
+        // Callbacks hold their deadline, within the inline storage
+        const auto run_after = [&session](int i) {
+            const std::chrono::milliseconds delay(kMinDelay + i % 1000);
+            const Clock::time_point deadline = Clock::now() + delay;
+
+            return session.run_after(delay, [deadline](Session&) {
+                g_fired.fetch_add(1, std::memory_order_relaxed);
+
+                const long long lateness = (Clock::now() - deadline).count();
+                long long max = g_max_lateness.load();
+                while (lateness > max
+                       && !g_max_lateness.compare_exchange_weak(max,
+                                                                lateness)) {
+                }
+            });
+        };
+
+        measure("arm", kTimerCount, [&] {
+            for (int i = 0; i != kTimerCount; ++i) {
+                ids[i] = run_after(i);
+            }
+        });
+
+        if (churn) {
+            measure("cancel", kTimerCount / 2, [&] {
+                for (int i = 0; i < kTimerCount; i += 2) {
+                    session.cancel_timer(ids[i]);
+                }
+            });
+
+            measure("re-arm", kTimerCount / 2, [&] {
+                for (int i = 0; i < kTimerCount; i += 2) {
+                    ids[i] = run_after(i);
+                }
+            });
+        }
+
+        g_armed = true;
+    }
+
+    //! @brief Connects to the server and waits for the callbacks to be
+    //!        armed, returning the socket
+    int connect_client()
+    {
+        g_armed = false;
+
+        const int sfd = fserv::util::endpoint_tcp();
+        if (fserv::util::endpoint_connect(sfd, "127.0.0.1", kPort) != 0) {
+            std::printf("connect failed\n");
+            std::exit(1);
+        }
+
+        while (!g_armed) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        return sfd;
+    }
+
+    //! @brief Waits until count callbacks have run or timeout has passed
+    void wait_fired(int count, std::chrono::seconds timeout)
+    {
+        const auto start = Clock::now();
+        while (g_fired < count && Clock::now() - start < timeout) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+int main()
+{
+    fserv::BasicServer<fserv::BasicClient> server;
+
+    // The first session churns its callbacks, the second is closed with
+    // all of its callbacks armed
+    static bool churn = true;
+    server.bind_new_client_callback(
+        [](Session& session) { arm(session, churn); });
+
+    if (!server.bind(kPort, 16)) {
+        std::printf("bind failed\n");
+        return 1;
+    }
+
+    std::thread runner([&server] { server.run(2, 16, 0); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Every callback runs once its delay has passed
+    int sfd = connect_client();
+    wait_fired(kTimerCount, std::chrono::seconds(10));
+    std::printf("fired %d of %d, at most %.1f ms past their deadline\n",
+                g_fired.load(),
+                kTimerCount,
+                g_max_lateness / 1e6);
+    ::close(sfd);
+
+    // None runs once its session has closed
+    churn = false;
+    g_fired = 0;
+    sfd = connect_client();
+    const int fired = g_fired;
+    ::close(sfd);
+    std::this_thread::sleep_for(std::chrono::milliseconds(kMinDelay + 2000));
+    std::printf("fired %d before and %d after closing the session with %d "
+                "armed\n",
+                fired,
+                g_fired - fired,
+                kTimerCount);
+
+    server.stop();
+    runner.join();
+
+    return 0;
+}
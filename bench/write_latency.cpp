@@ -0,0 +1,235 @@
+/* write_latency.cpp -- v1.0
+   Measures the latency of urgent messages written behind bulk data on one
+   connection, with and without the user-space write queue */
+
+#include "fserv/basic_client.hpp"
+#include "fserv/basic_server.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    using Session = fserv::ClientSession<fserv::BasicClient>;
+    using Clock = std::chrono::steady_clock;
+
+    // Interval between writes
+    constexpr std::chrono::milliseconds kTick(2);
+    // Size of each bulk message
+    constexpr int kBulkSize = 128 * 1024;
+    // Rate at which bulk messages are written (bytes/s)
+    constexpr double kWriteRate = 64e6;
+    // Rate at which the receiver reads (bytes/s)
+    constexpr double kReadRate = 50e6;
+    // Receive buffer of the receiver
+    constexpr int kReceiveBuffer = 64 * 1024;
+    // Length of each run
+    constexpr std::chrono::seconds kDuration(3);
+    // Size of the message header: type, then big-endian payload size
+    constexpr int kHeaderSize = 5;
+
+    //! @struct Mode
+    /*! How the urgent messages are written
+     */
+    struct Mode {
+        const char* name;
+        bool urgent;
+        int notsent_low_watermark;
+    };
+
+    //! @brief Writes a message header to buff
+    void put_header(char* buff, char type, int size)
+    {
+        buff[0] = type;
+        for (int i = 0; i != 4; ++i) {
+            buff[1 + i] = static_cast<char>(size >> (24 - 8 * i));
+        }
+    }
+
+    //! @brief Reads from the server at the receiver's rate, returning the
+    //!        latencies of the urgent messages (ms)
+    std::vector<double> receive(int port, std::uint64_t* bulk_bytes)
+    {
+        std::vector<double> latencies;
+
+        const int sfd = fserv::util::endpoint_tcp();
+        ::setsockopt(sfd,
+                     SOL_SOCKET,
+                     SO_RCVBUF,
+                     &kReceiveBuffer,
+                     sizeof(kReceiveBuffer));
+        if (fserv::util::endpoint_connect(sfd, "127.0.0.1", port) != 0) {
+            return ::close(sfd), latencies;
+        }
+
+        std::vector<char> buff(kReceiveBuffer);
+        char header[kHeaderSize];
+        int header_size = 0;
+        char stamp[8];
+        char type = 0;
+        int remaining = 0;
+
+        const auto start = Clock::now();
+        std::uint64_t received = 0;
+        for (auto now = start; now - start < kDuration; now = Clock::now()) {
+            // Read no faster than the receiver's rate
+            const double elapsed = std::chrono::duration<double>(now - start)
+                                       .count();
+            const std::int64_t allowed
+                = static_cast<std::int64_t>(elapsed * kReadRate) - received;
+            if (allowed <= 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                continue;
+            }
+
+            const int n = ::recv(
+                sfd,
+                buff.data(),
+                std::min<std::int64_t>(allowed, kReceiveBuffer),
+                0);
+            if (n <= 0) {
+                break;
+            }
+
+            received += n;
+            for (int i = 0; i != n;) {
+                if (remaining == 0) {
+                    header[header_size++] = buff[i++];
+                    if (header_size == kHeaderSize) {
+                        header_size = 0;
+                        type = header[0];
+                        for (int b = 1; b != kHeaderSize; ++b) {
+                            remaining = (remaining << 8)
+                                        | static_cast<unsigned char>(
+                                            header[b]);
+                        }
+                    }
+
+                    continue;
+                }
+
+                const int k = std::min(remaining, n - i);
+                if (type == 'U') {
+                    std::memcpy(stamp + 8 - remaining, &buff[i], k);
+                } else {
+                    *bulk_bytes += k;
+                }
+
+                i += k;
+                remaining -= k;
+                if (remaining == 0 && type == 'U') {
+                    std::int64_t sent_ns = 0;
+                    std::memcpy(&sent_ns, stamp, sizeof(sent_ns));
+                    const std::int64_t now_ns
+                        = Clock::now().time_since_epoch().count();
+                    latencies.push_back((now_ns - sent_ns) / 1e6);
+                }
+            }
+        }
+
+        ::close(sfd);
+        return latencies;
+    }
+
+    //! @brief Runs the server and the receiver in one mode, printing the
+    //!        latency percentiles
+    void run(const Mode& mode, int port)
+    {
+        static std::vector<char> bulk(kHeaderSize + kBulkSize, 'b');
+        put_header(bulk.data(), 'B', kBulkSize);
+
+        fserv::BasicServer<fserv::BasicClient> server;
+
+        fserv::ClientOptions options;
+        options.queue_writes = true;
+        options.notsent_low_watermark = mode.notsent_low_watermark;
+        server.set_client_options(options);
+
+        const bool urgent = mode.urgent;
+        server.bind_new_client_callback([urgent](Session& session) {
+            const auto start = Clock::now();
+            std::int64_t written = 0;
+
+            // Bulk messages keep up with the write rate however late the
+            // ticks run
+            session.run_every(kTick, [=](Session& session) mutable {
+                const double elapsed
+                    = std::chrono::duration<double>(Clock::now() - start)
+                          .count();
+                while (written < elapsed * kWriteRate) {
+                    session.write(bulk.data(), static_cast<int>(bulk.size()));
+                    written += kBulkSize;
+                }
+
+                char stamp[kHeaderSize + 8];
+                put_header(stamp, 'U', 8);
+                const std::int64_t now_ns
+                    = Clock::now().time_since_epoch().count();
+                std::memcpy(stamp + kHeaderSize, &now_ns, sizeof(now_ns));
+                urgent ? session.write_urgent(stamp, sizeof(stamp))
+                       : session.write(stamp, sizeof(stamp));
+            });
+        });
+
+        if (!server.bind(port, 16)) {
+            std::printf("%-24s bind failed\n", mode.name);
+            return;
+        }
+
+        std::thread runner([&server] { server.run(1, 16, 0); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        std::uint64_t bulk_bytes = 0;
+        std::vector<double> latencies = receive(port, &bulk_bytes);
+
+        server.stop();
+        runner.join();
+
+        if (latencies.empty()) {
+            std::printf("%-24s no urgent message received\n", mode.name);
+            return;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        const auto percentile = [&latencies](double p) {
+            return latencies[static_cast<std::size_t>(
+                p * (latencies.size() - 1))];
+        };
+
+        std::printf("%-24s %4zu stamps  p50 %7.2f ms  p99 %7.2f ms  "
+                    "bulk %4.1f MB/s\n",
+                    mode.name,
+                    latencies.size(),
+                    percentile(0.5),
+                    percentile(0.99),
+                    bulk_bytes / 1e6 / kDuration.count());
+    }
+} // namespace
+
+int main()
+{
+    const Mode modes[] = {
+        {"FIFO writes", false, 0},
+        {"write_urgent, default", true, 0},
+        {"write_urgent, notsent", true, 16 * 1024},
+    };
+
+    std::printf("%d KiB bulk messages at %.0f MB/s, urgent stamp every "
+                "%lld ms, read at %.0f MB/s for %lld s\n",
+                kBulkSize / 1024,
+                kWriteRate / 1e6,
+                static_cast<long long>(kTick.count()),
+                kReadRate / 1e6,
+                static_cast<long long>(kDuration.count()));
+
+    int port = 9471;
+    for (const Mode& mode: modes) {
+        run(mode, port++);
+    }
+
+    return 0;
+}
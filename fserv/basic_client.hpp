@@ -3,12 +3,23 @@
 
 #pragma once
 
+#include "buffer_pool.hpp"
 #include "client_session_manager.hpp"
 #include "endpoint.hpp"
+#include "framing.hpp"
+#include "mirrored_ring.hpp"
+#include "mutex.hpp"
+#include "output_queue.hpp"
+#include "zerocopy_receive.hpp"
+#include <atomic>
+#include <cerrno>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include <sys/ioctl.h>
+#include <thread>
+#include <utility>
 
 namespace fserv {
 
@@ -17,7 +28,22 @@ namespace fserv {
      */
     class BasicClient {
         static const int kBuffSize = 4096;
+        // Consecutive under-filled reads before the read buffer shrinks
+        static const int kShrinkThreshold = 8;
+        // Largest receive low watermark set from a missing message size
+        static const int kMaxLowWatermark = 64 * 1024;
     public:
+        //! Dtor.
+        ~BasicClient()
+        {
+            util::destroy(zerocopy_region_);
+            util::destroy(read_ring_);
+            if (session_manager_) {
+                session_manager_->buffer_pool()->release(message_buff_,
+                                                         buff_class_);
+            }
+        }
+
         //! Default constructor.
         BasicClient() = default;
 
@@ -30,17 +56,306 @@ namespace fserv {
                     ClientSessionManager<BasicClient>* session_manager)
             : sfd_(sfd)
             , session_manager_(session_manager)
-        {}
+        {
+            const ClientOptions& options = session_manager_->options();
+
+            adaptive_ = options.adaptive_read_buffer;
+            framed_ = static_cast<bool>(options.framer);
+            read_ring_size_ = options.read_ring_size;
+            zerocopy_size_ = framed_ ? 0 : options.zerocopy_receive_size;
+            adaptive_lowat_ = options.adaptive_receive_low_watermark;
+            cork_flush_size_ = options.cork_flush_size;
+            queue_writes_
+                = options.queue_writes || options.output_high_watermark > 0;
+
+            if (options.notsent_low_watermark > 0) {
+                util::endpoint_set_notsent_lowat(sfd_,
+                                                 options.notsent_low_watermark);
+            }
+
+            set_receive_low_watermark(options.receive_low_watermark);
+            update_receive_low_watermark();
+
+            buff_class_ = util::BufferPool::class_of(kBuffSize);
+            if (adaptive_) {
+                max_buff_class_
+                    = util::BufferPool::class_of(options.max_read_size);
+                if (buff_class_ > max_buff_class_) {
+                    buff_class_ = max_buff_class_;
+                }
+            }
+
+            next_buff_class_ = buff_class_;
+        }
 
         //! Reads data from the client.
+        //! Bytes go to the buffer posted by read_into() first, if any, and
+        //! the rest to the returned buffer.
         //! @param nbytes
         //!     Pointer to store the number of bytes read
         //! @return
-        //!     Pointer to the buffer containing the data
+        //!     Pointer to the buffer containing the data not read into the
+        //!     posted buffer
         const char* read(int* nbytes)
         {
-            *nbytes = util::endpoint_read(sfd_, message_buff_, kBuffSize);
-            return message_buff_;
+            read_into_size_ = 0;
+            last_read_zerocopy_ = false;
+
+            int copy_hint = 0;
+            if (zerocopy_size_ != 0 && into_buff_ == nullptr
+                && !zerocopy_held_.load(std::memory_order_acquire)) {
+                const int mapped = read_zerocopy(&copy_hint);
+                if (mapped > 0) {
+                    // Nothing is copied alongside mapped pages, the bytes of
+                    // a partial page are left for the next read
+                    read_size_ = mapped;
+                    last_read_zerocopy_ = true;
+                    return *nbytes = mapped, zerocopy_region_.ptr_to_mem;
+                }
+            }
+
+            char* data = nullptr;
+            int size = 0;
+            if (!reserve(&data, &size)) {
+                return *nbytes = -1, nullptr;
+            }
+
+            // Copy no further than the next page that can be mapped
+            if (copy_hint > 0 && copy_hint < size) {
+                size = copy_hint;
+            }
+
+            if (into_buff_ == nullptr) {
+                read_size_ = size;
+                *nbytes = util::endpoint_read(sfd_, data, size);
+            } else {
+                const int into_size = into_size_ - into_filled_;
+                read_size_ = into_size + size;
+                *nbytes = util::endpoint_readv(
+                    sfd_, into_buff_ + into_filled_, into_size, data, size);
+                if (*nbytes > 0) {
+                    read_into_size_
+                        = *nbytes < into_size ? *nbytes : into_size;
+                    into_filled_ += read_into_size_;
+                }
+            }
+
+            const int spilled = *nbytes - read_into_size_;
+            if (spilled > 0) {
+                if (util::is_allocated(read_ring_)) {
+                    util::commit(read_ring_, spilled);
+                } else if (adaptive_) {
+                    adapt_buffer(spilled, size);
+                }
+            }
+
+            return data;
+        }
+
+        //! @return
+        //!     Number of bytes requested by the last call to read(), those
+        //!     mapped if it was a zero-copy read
+        int last_read_size() const
+        {
+            return read_size_;
+        }
+
+        //! Splits data returned by the last read into messages.
+        //! @param framer
+        //!     Stream framer
+        //! @param data
+        //!     Data returned by the last read
+        //! @param size
+        //!     Size of the data returned by the last read
+        //! @param on_message
+        //!     Called with each complete message and its size; stops the
+        //!     split by returning false
+        //! @return
+        //!     False on a protocol violation, true otherwise
+        template <typename CallbackType>
+        bool frame(const AnyFramer& framer,
+                   const char* data,
+                   int size,
+                   CallbackType&& on_message)
+        {
+            if (!util::is_allocated(read_ring_)) {
+                return frame_assembler_.feed(framer, data, size, on_message);
+            }
+
+            // Partial messages are left in the ring, contiguous with the
+            // bytes that complete them on the next read
+            bool proceed = true;
+            const int consumed
+                = FrameAssembler::consume(framer,
+                                          util::read_ptr(read_ring_),
+                                          util::readable_size(read_ring_),
+                                          on_message,
+                                          &proceed,
+                                          &ring_scanned_);
+            if (consumed == -1) {
+                return false;
+            }
+
+            util::consume(read_ring_, consumed);
+            return true;
+        }
+
+        //! @return
+        //!     True if the last read mapped pages into the zero-copy region
+        //!     rather than copying
+        bool last_read_zerocopy() const
+        {
+            return last_read_zerocopy_;
+        }
+
+        //! Releases the pages mapped by the last zero-copy read, letting the
+        //! region be reused. May be called from any thread.
+        void release_zerocopy()
+        {
+            if (zerocopy_held_.load(std::memory_order_acquire)) {
+                util::release(zerocopy_region_, zerocopy_mapped_);
+                zerocopy_held_.store(false, std::memory_order_release);
+            }
+        }
+
+        //! Posts a buffer that the next reads are made into, until full.
+        //! @param buff
+        //!     Destination buffer, must remain valid until filled
+        //! @param size
+        //!     Destination buffer size
+        void read_into(char* buff, int size)
+        {
+            into_buff_ = size > 0 ? buff : nullptr;
+            into_size_ = size;
+            into_filled_ = 0;
+        }
+
+        //! @return
+        //!     True if a posted read-into buffer is being filled
+        bool reading_into() const
+        {
+            return into_buff_ != nullptr;
+        }
+
+        //! @return
+        //!     True if the posted read-into buffer is full
+        bool read_into_full() const
+        {
+            return into_buff_ != nullptr && into_filled_ == into_size_;
+        }
+
+        //! @return
+        //!     Number of bytes the last read placed in the read-into buffer
+        int last_read_into_size() const
+        {
+            return read_into_size_;
+        }
+
+        //! Clears the filled read-into buffer.
+        //! @param size
+        //!     Pointer to store the buffer size
+        //! @return
+        //!     The filled buffer
+        char* take_read_into(int* size)
+        {
+            char* buff = into_buff_;
+            *size = into_size_;
+            read_into(nullptr, 0);
+            return buff;
+        }
+
+        //! Copies bytes into the read-into buffer.
+        //! @param data
+        //!     Source bytes
+        //! @param size
+        //!     Number of source bytes
+        //! @return
+        //!     Number of bytes copied
+        int fill_into(const char* data, int size)
+        {
+            const int remaining = into_size_ - into_filled_;
+            const int n = size < remaining ? size : remaining;
+
+            std::memcpy(into_buff_ + into_filled_, data, n);
+            into_filled_ += n;
+            return n;
+        }
+
+        //! @return
+        //!     Number of bytes read but not yet framed into messages
+        int buffered_size() const
+        {
+            if (!framed_) {
+                return 0;
+            }
+
+            return util::is_allocated(read_ring_)
+                       ? util::readable_size(read_ring_)
+                       : frame_assembler_.buffered_size();
+        }
+
+        //! @return
+        //!     True if the data returned by read() is kept in the read ring,
+        //!     counting in buffered_size() until framed
+        bool reads_buffered() const
+        {
+            return framed_ && util::is_allocated(read_ring_);
+        }
+
+        //! Moves bytes read but not yet framed into the read-into buffer.
+        void drain_into()
+        {
+            char* buff = into_buff_ + into_filled_;
+            int size = into_size_ - into_filled_;
+
+            if (!util::is_allocated(read_ring_)) {
+                into_filled_ += frame_assembler_.take(buff, size);
+                return;
+            }
+
+            const int buffered = util::readable_size(read_ring_);
+            size = size < buffered ? size : buffered;
+
+            std::memcpy(buff, util::read_ptr(read_ring_), size);
+            util::consume(read_ring_, size);
+            ring_scanned_ = ring_scanned_ > size ? ring_scanned_ - size : 0;
+            into_filled_ += size;
+        }
+
+        //! Sets the receive low watermark that the client falls back to when
+        //! no missing message size is known.
+        //! Applied by update_receive_low_watermark().
+        //! @param size
+        //!     Low watermark (bytes), zero for the kernel default
+        void set_receive_low_watermark(int size)
+        {
+            lowat_ = size > 1 ? size : 1;
+        }
+
+        //! Applies the receive low watermark for the next wakeup: the number
+        //! of bytes missing from the read-into buffer or the buffered message
+        //! when adaptive, the configured watermark otherwise.
+        void update_receive_low_watermark()
+        {
+            int size = lowat_;
+            if (adaptive_lowat_) {
+                int missing = 0;
+                if (into_buff_ != nullptr) {
+                    missing = into_size_ - into_filled_;
+                } else if (framed_) {
+                    missing = missing_frame_size();
+                }
+
+                if (missing > size) {
+                    size = missing < kMaxLowWatermark ? missing
+                                                      : kMaxLowWatermark;
+                }
+            }
+
+            if (size != socket_lowat_
+                && util::endpoint_set_rcvlowat(sfd_, size) == 0) {
+                socket_lowat_ = size;
+            }
         }
 
         //! Reads out-of-band data from the client.
@@ -63,27 +378,195 @@ namespace fserv {
         }
 
         //! Writes data to the client.
+        //! Data is appended to the output queue while corked by the calling
+        //! thread or while earlier writes are still queued. The queue is
+        //! sent once uncorked or once it reaches the flush size.
         //! @param buff
         //!     Buffer containing the data
         //! @param size
         //!     Size of the buffer
         //! @return
-        //!     Number of bytes written
-        int write(const char* buff, int size) const
+        //!     Number of bytes written or queued
+        int write(const char* buff, int size)
         {
-            int total_size = size;
+            std::lock_guard<util::Mutex> l(output_lock_);
 
-            while (size > 0) {
-                int n = util::endpoint_write(sfd_, buff, size);
-                if (n <= 0) {
-                    break;
+            const bool corked = corked_by_ == std::this_thread::get_id();
+            if (output_.empty() && (!corked || size >= cork_flush_size_)) {
+                const int n = send(buff, size);
+                if (n == size || !queue_writes_) {
+                    return n;
                 }
 
-                size -= n;
-                buff += n;
+                output_.push_back(buff, size, n);
+                return size;
             }
 
-            return total_size - size;
+            output_.push_back(buff, size);
+            if (!corked || output_.size() >= cork_flush_size_) {
+                flush_output();
+            }
+
+            return size;
+        }
+
+        //! Writes data to the client ahead of queued messages not yet
+        //! started, behind earlier urgent ones.
+        //! @param buff
+        //!     Buffer containing the data
+        //! @param size
+        //!     Size of the buffer
+        //! @return
+        //!     Number of bytes written or queued
+        int write_urgent(const char* buff, int size)
+        {
+            std::unique_lock<util::Mutex> l(output_lock_);
+            if (output_.empty()) {
+                l.unlock();
+                return write(buff, size);
+            }
+
+            output_.push_urgent(buff, size);
+            if (corked_by_ != std::this_thread::get_id()) {
+                flush_output();
+            }
+
+            return size;
+        }
+
+        //! Drops queued messages not yet started.
+        //! @return
+        //!     Number of bytes dropped
+        int discard_output()
+        {
+            std::lock_guard<util::Mutex> l(output_lock_);
+            return output_.discard();
+        }
+
+        //! @return
+        //!     Number of queued bytes not yet sent
+        int pending_output_size() const
+        {
+            std::lock_guard<util::Mutex> l(output_lock_);
+            return output_.size();
+        }
+
+        //! Sends queued bytes until done or the socket would block.
+        void flush()
+        {
+            std::lock_guard<util::Mutex> l(output_lock_);
+            flush_output();
+        }
+
+        //! @return
+        //!     True if the client was last armed for read events
+        bool read_armed() const
+        {
+            return read_armed_;
+        }
+
+        //! @param armed
+        //!     Whether the client is being armed for read events
+        void set_read_armed(bool armed)
+        {
+            read_armed_ = armed;
+        }
+
+        //! @return
+        //!     True if reads are paused until queued output drains
+        bool read_paused() const
+        {
+            return read_paused_;
+        }
+
+        //! @param paused
+        //!     Whether reads are paused until queued output drains
+        void set_read_paused(bool paused)
+        {
+            read_paused_ = paused;
+        }
+
+        //! Buffers the calling thread's writes until it calls uncork().
+        //! Writes from other threads are not held back.
+        void cork()
+        {
+            std::lock_guard<util::Mutex> l(output_lock_);
+            corked_by_ = std::this_thread::get_id();
+        }
+
+        //! Sends buffered writes and stops buffering, if corked by the
+        //! calling thread.
+        void uncork()
+        {
+            std::lock_guard<util::Mutex> l(output_lock_);
+            if (corked_by_ == std::this_thread::get_id()) {
+                corked_by_ = std::thread::id();
+                flush_output();
+            }
+        }
+
+        //! Schedules a callback on the client.
+        //! @param delay
+        //!     Delay before the first run
+        //! @param interval
+        //!     Delay between runs, zero to run once
+        //! @param callback
+        //!     Callback to run
+        //! @return
+        //!     Identifier to cancel the callback with
+        TimerId schedule_timer(std::chrono::milliseconds delay,
+                               std::chrono::milliseconds interval,
+                               TimerCallback<BasicClient>&& callback)
+        {
+            return session_manager_->schedule_timer(
+                this, delay, interval, std::move(callback));
+        }
+
+        //! Cancels a scheduled callback.
+        //! @param id
+        //!     Callback identifier
+        void cancel_timer(TimerId id)
+        {
+            session_manager_->cancel_timer(this, id);
+        }
+
+        //! @return
+        //!     Latest TCP_INFO sample of the connection
+        TcpSample tcp_sample()
+        {
+            return session_manager_->tcp_sample(this);
+        }
+
+        //! Routes the client's data and close events to a handler.
+        //! @param handler
+        //!     Event handler, null for the packet sink
+        void set_event_handler(ClientEventHandler<BasicClient>* handler)
+        {
+            session_manager_->set_event_handler(this, handler);
+        }
+
+        //! Relays the client to a new outbound connection.
+        //! @param addr
+        //!     Remote address
+        //! @param timeouts
+        //!     Deadlines of the outbound connection
+        //! @return
+        //!     False if the connect could not be started
+        bool proxy(const sockaddr_in& addr, const ClientTimeouts& timeouts)
+        {
+            return session_manager_->proxy(this, addr, timeouts);
+        }
+
+        //! Checks, without reading, that the peer has not closed the
+        //! connection.
+        //! @return
+        //!     False if the connection is closed or has failed, true
+        //!     otherwise
+        bool peer_open() const
+        {
+            char byte = 0;
+            const int n = ::recv(sfd_, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+            return n > 0 || (n == -1 && (errno == EAGAIN || errno == EINTR));
         }
 
         //! Rearms the client for additional read.
@@ -92,17 +575,284 @@ namespace fserv {
             session_manager_->rearm(this);
         }
 
-        //! Terminates the client.
+        //! Terminates the client, once buffered writes are sent.
         void terminate()
         {
+            uncork();
             session_manager_->terminate(this);
         }
+
+        // Non-copyable object
+        BasicClient(const BasicClient&) = delete;
+        BasicClient& operator=(const BasicClient&) = delete;
     private:
         /*! Socket descriptor */
         int sfd_ = 0;
-        /*! Message buffer */
-        char message_buff_[kBuffSize + 1] = {};
+        /*! Message buffer, drawn from the session manager's buffer pool */
+        char* message_buff_ = nullptr;
+        /*! Size class of the message buffer */
+        int buff_class_ = 0;
+        /*! Size class of the message buffer from the next read onwards */
+        int next_buff_class_ = 0;
+        /*! Largest size class the message buffer may grow to */
+        int max_buff_class_ = 0;
+        /*! Whether the message buffer is resized to fit the traffic */
+        bool adaptive_ = false;
+        /*! Number of consecutive reads that filled under a quarter of the
+         *! message buffer */
+        int short_read_count_ = 0;
+        /*! Number of bytes requested by the last read */
+        int read_size_ = 0;
+        /*! Framing state, holds messages split across reads */
+        FrameAssembler frame_assembler_;
+        /*! Whether reads are split into messages */
+        bool framed_ = false;
+        /*! Size of the mirrored read ring, zero if reading to message_buff_ */
+        int read_ring_size_ = 0;
+        /*! Mirrored read ring, allocated on first read */
+        util::MirroredRing read_ring_;
+        /*! Leading bytes of the partial message in the read ring known to
+         *! hold no end of frame */
+        int ring_scanned_ = 0;
+        /*! Posted read-into buffer */
+        char* into_buff_ = nullptr;
+        /*! Posted read-into buffer size */
+        int into_size_ = 0;
+        /*! Number of bytes placed in the read-into buffer so far */
+        int into_filled_ = 0;
+        /*! Number of bytes the last read placed in the read-into buffer */
+        int read_into_size_ = 0;
+        /*! Size of the zero-copy receive region, zero if disabled */
+        int zerocopy_size_ = 0;
+        /*! Zero-copy receive region, mapped on first read */
+        util::ZeroCopyRegion zerocopy_region_;
+        /*! Number of bytes mapped by the last zero-copy read */
+        int zerocopy_mapped_ = 0;
+        /*! Set while mapped pages are held by the application */
+        std::atomic<bool> zerocopy_held_ = false;
+        /*! Whether the last read mapped pages rather than copying */
+        bool last_read_zerocopy_ = false;
+        /*! Configured receive low watermark */
+        int lowat_ = 1;
+        /*! Receive low watermark currently set on the socket */
+        int socket_lowat_ = 1;
+        /*! Whether the low watermark follows missing message sizes */
+        bool adaptive_lowat_ = false;
+        /*! Thread whose writes are appended to the output buffer, none
+         *! unless corked */
+        std::thread::id corked_by_;
+        /*! Output buffer size at which corked writes are sent */
+        int cork_flush_size_ = 0;
+        /*! Whether writes the socket cannot take are queued */
+        bool queue_writes_ = false;
+        /*! Writes not yet sent */
+        util::OutputQueue output_;
+        /*! Serializes writes, flushes and corking, which handlers, the pool
+         *! and other threads may do at once */
+        mutable util::Mutex output_lock_{"BasicClient::output_lock_"};
+        /*! Whether the client was last armed for read events */
+        bool read_armed_ = false;
+        /*! Set while reads are paused until queued output drains */
+        bool read_paused_ = false;
         /*! Upstream session manager */
         ClientSessionManager<BasicClient>* session_manager_ = nullptr;
+
+        //! Sends queued bytes until done or the socket would block, with the
+        //! output lock held.
+        void flush_output()
+        {
+            struct iovec iov[util::OutputQueue::kMaxSpans];
+
+            while (!output_.empty()) {
+                const int count
+                    = output_.gather(iov, util::OutputQueue::kMaxSpans);
+                const int n = util::endpoint_writev(sfd_, iov, count);
+                if (n <= 0) {
+                    break;
+                }
+
+                output_.consume(n);
+            }
+        }
+
+        //! Sends data until done or the socket would block.
+        //! @param buff
+        //!     Buffer containing the data
+        //! @param size
+        //!     Size of the buffer
+        //! @return
+        //!     Number of bytes sent
+        int send(const char* buff, int size) const
+        {
+            int total_size = size;
+
+            while (size > 0) {
+                int n = util::endpoint_write(sfd_, buff, size);
+                if (n <= 0) {
+                    break;
+                }
+
+                size -= n;
+                buff += n;
+            }
+
+            return total_size - size;
+        }
+
+        //! @return
+        //!     Number of bytes missing from the buffered partial message,
+        //!     zero if unknown
+        int missing_frame_size() const
+        {
+            const AnyFramer& framer = session_manager_->options().framer;
+
+            if (!util::is_allocated(read_ring_)) {
+                return frame_assembler_.remaining(framer);
+            }
+
+            return FrameAssembler::remaining(framer,
+                                             util::read_ptr(read_ring_),
+                                             util::readable_size(read_ring_),
+                                             ring_scanned_);
+        }
+
+        //! Maps received pages into the zero-copy region.
+        //! Disables zero-copy receive if the socket does not support it.
+        //! @param copy_hint[out]
+        //!     Number of bytes to copy before further pages can be mapped
+        //! @return
+        //!     Number of bytes mapped, zero if the next bytes must be copied
+        int read_zerocopy(int* copy_hint)
+        {
+            if (!util::init(zerocopy_region_, sfd_, zerocopy_size_)) {
+                zerocopy_size_ = 0;
+                return 0;
+            }
+
+            const int mapped = util::endpoint_read_zerocopy(
+                sfd_, zerocopy_region_, copy_hint);
+            if (mapped == -1) {
+                if (errno != EAGAIN) {
+                    util::destroy(zerocopy_region_);
+                    zerocopy_size_ = 0;
+                }
+
+                return 0;
+            }
+
+            if (mapped > 0) {
+                zerocopy_mapped_ = mapped;
+                zerocopy_held_.store(true, std::memory_order_release);
+            }
+
+            return mapped;
+        }
+
+        //! Picks the buffer the next read lands in.
+        //! @param data[out]
+        //!     Read buffer
+        //! @param size[out]
+        //!     Read buffer size
+        //! @return
+        //!     True on success, false on failure with errno set
+        bool reserve(char** data, int* size)
+        {
+            if (read_ring_size_ == 0) {
+                if (!prepare_buffer()) {
+                    errno = ENOMEM;
+                    return false;
+                }
+
+                *data = message_buff_;
+                *size = util::BufferPool::class_size(buff_class_);
+                return true;
+            }
+
+            if (!util::init(read_ring_, read_ring_size_)) {
+                errno = ENOMEM;
+                return false;
+            }
+
+            // Unframed data is done with once handed out
+            if (!framed_) {
+                util::consume(read_ring_, util::readable_size(read_ring_));
+            }
+
+            // Ring is filled by a single partial message
+            *size = util::writable_size(read_ring_);
+            if (*size == 0) {
+                errno = ENOBUFS;
+                return false;
+            }
+
+            *data = util::write_ptr(read_ring_);
+            return true;
+        }
+
+        //! Swaps in a buffer of the next size class, if it has changed.
+        //! Data returned by the previous read is no longer referenced by the
+        //! time the next read starts, so the swap is deferred until then.
+        //! @return
+        //!     True if a message buffer is available, false otherwise
+        bool prepare_buffer()
+        {
+            if (message_buff_ && next_buff_class_ == buff_class_) {
+                return true;
+            }
+
+            util::BufferPool* pool = session_manager_->buffer_pool();
+
+            char* buff = pool->acquire(next_buff_class_);
+            if (buff == nullptr) {
+                return message_buff_ != nullptr;
+            }
+
+            pool->release(message_buff_, buff_class_);
+            message_buff_ = buff;
+            buff_class_ = next_buff_class_;
+
+            return true;
+        }
+
+        //! Picks the size class of the next read from the size of this one.
+        //! A full read grows the buffer to fit the bytes still pending on the
+        //! socket; a run of reads under a quarter full shrinks it one class.
+        //! @param nbytes
+        //!     Number of bytes returned by the last read
+        //! @param size
+        //!     Number of bytes requested by the last read
+        void adapt_buffer(int nbytes, int size)
+        {
+            if (nbytes == size) {
+                short_read_count_ = 0;
+
+                int pending = 0;
+                if (::ioctl(sfd_, FIONREAD, &pending) == -1) {
+                    pending = 0;
+                }
+
+                int size_class = util::BufferPool::class_of(pending);
+                if (size_class <= buff_class_) {
+                    size_class = buff_class_ + 1;
+                }
+
+                next_buff_class_ = size_class < max_buff_class_
+                                       ? size_class
+                                       : max_buff_class_;
+                return;
+            }
+
+            if (nbytes >= size / 4) {
+                short_read_count_ = 0;
+                return;
+            }
+
+            if (++short_read_count_ >= kShrinkThreshold) {
+                short_read_count_ = 0;
+                if (buff_class_ > 0) {
+                    next_buff_class_ = buff_class_ - 1;
+                }
+            }
+        }
     };
 } // namespace fserv
@@ -36,6 +36,16 @@ namespace fserv {
         = fserv::enable_client_data_received<BasicClientHandler<ClientType>,
                                              ClientType>;
 
+    template <typename ClientType>
+    using client_read_completed
+        = fserv::enable_client_read_completed<BasicClientHandler<ClientType>,
+                                              ClientType>;
+
+    template <typename ClientType>
+    using client_zerocopy_received = fserv::enable_client_zerocopy_received<
+        BasicClientHandler<ClientType>,
+        ClientType>;
+
     template <typename ClientType>
     using client_oob_received
         = fserv::enable_client_oob_received<BasicClientHandler<ClientType>,
@@ -50,6 +60,8 @@ namespace fserv {
                                public client_accepted<ClientType>,
                                public client_closed<ClientType>,
                                public client_received<ClientType>,
+                               public client_read_completed<ClientType>,
+                               public client_zerocopy_received<ClientType>,
                                public client_oob_received<ClientType> {
         using ClientSessionType = ClientSession<ClientType>;
 
@@ -63,6 +75,12 @@ namespace fserv {
         using DataReceivedCallbackType
             = std::function<void(ClientSessionType&, const char*, const int)>;
 
+        using ReadCompletedCallbackType
+            = std::function<void(ClientSessionType&, char*, const int)>;
+
+        using ZeroCopyReceivedCallbackType
+            = std::function<void(ClientSessionType&, const char*, const int)>;
+
         using OobReceivedCallbackType
             = std::function<void(ClientSessionType&, const char)>;
     public:
@@ -74,7 +92,7 @@ namespace fserv {
             std::shared_ptr<NewClientCallbackType> callback;
 
             {
-                std::lock_guard<std::mutex> lock_callback_access(
+                std::lock_guard<util::Mutex> lock_callback_access(
                     lock_callback_access_);
                 callback = on_client_error_;
             }
@@ -93,7 +111,7 @@ namespace fserv {
             std::shared_ptr<NewClientCallbackType> callback;
 
             {
-                std::lock_guard<std::mutex> lock_callback_access(
+                std::lock_guard<util::Mutex> lock_callback_access(
                     lock_callback_access_);
                 callback = on_new_client_;
             }
@@ -112,7 +130,7 @@ namespace fserv {
             std::shared_ptr<ClientClosedCallbackType> callback;
 
             {
-                std::lock_guard<std::mutex> lock_callback_access(
+                std::lock_guard<util::Mutex> lock_callback_access(
                     lock_callback_access_);
                 callback = on_client_closed_;
             }
@@ -137,7 +155,7 @@ namespace fserv {
             std::shared_ptr<DataReceivedCallbackType> callback;
 
             {
-                std::lock_guard<std::mutex> lock_callback_access(
+                std::lock_guard<util::Mutex> lock_callback_access(
                     lock_callback_access_);
                 callback = on_data_received_;
             }
@@ -148,6 +166,59 @@ namespace fserv {
             }
         }
 
+        //! Handles client read-into buffer filled.
+        //! @param client
+        //!     Triggered client
+        //! @param buff
+        //!     Filled buffer
+        //! @param size
+        //!     Buffer size
+        void client_read_completed(ClientSessionType& client,
+                                   char* buff,
+                                   const int size)
+        {
+            std::shared_ptr<ReadCompletedCallbackType> callback;
+
+            {
+                std::lock_guard<util::Mutex> lock_callback_access(
+                    lock_callback_access_);
+                callback = on_read_completed_;
+            }
+
+            if (callback.get()) {
+                const auto& ref = *callback;
+                ref(client, buff, size);
+            }
+        }
+
+        //! Handles client data received by page remapping.
+        //! Released immediately if no callback is bound.
+        //! @param client
+        //!     Triggered client
+        //! @param data
+        //!     Mapped pages, valid until released through the session
+        //! @param size
+        //!     Number of bytes mapped
+        void client_zerocopy_received(ClientSessionType& client,
+                                      const char* data,
+                                      const int size)
+        {
+            std::shared_ptr<ZeroCopyReceivedCallbackType> callback;
+
+            {
+                std::lock_guard<util::Mutex> lock_callback_access(
+                    lock_callback_access_);
+                callback = on_zerocopy_received_;
+            }
+
+            if (callback.get()) {
+                const auto& ref = *callback;
+                ref(client, data, size);
+            } else {
+                client.release_zerocopy();
+            }
+        }
+
         //! Handles client out-of-band data received.
         //! @param client
         //!     Triggered client
@@ -158,7 +229,7 @@ namespace fserv {
             std::shared_ptr<OobReceivedCallbackType> callback;
 
             {
-                std::lock_guard<std::mutex> lock_callback_access(
+                std::lock_guard<util::Mutex> lock_callback_access(
                     lock_callback_access_);
                 callback = on_oob_received_;
             }
@@ -175,7 +246,7 @@ namespace fserv {
         void bind_client_error_callback(
             const std::function<void(ClientSessionType&)>& fn)
         {
-            std::lock_guard<std::mutex> lock_callback_access(
+            std::lock_guard<util::Mutex> lock_callback_access(
                 lock_callback_access_);
             on_client_error_
                 = std::make_shared<std::function<void(ClientSessionType&)>>(fn);
@@ -187,7 +258,7 @@ namespace fserv {
         void bind_new_client_callback(
             const std::function<void(ClientSessionType&)>& fn)
         {
-            std::lock_guard<std::mutex> lock_callback_access(
+            std::lock_guard<util::Mutex> lock_callback_access(
                 lock_callback_access_);
             on_new_client_
                 = std::make_shared<std::function<void(ClientSessionType&)>>(fn);
@@ -199,7 +270,7 @@ namespace fserv {
         void bind_client_closed_callback(
             const std::function<void(ClientSessionType&)>& fn)
         {
-            std::lock_guard<std::mutex> lock_callback_access(
+            std::lock_guard<util::Mutex> lock_callback_access(
                 lock_callback_access_);
             on_client_closed_
                 = std::make_shared<std::function<void(ClientSessionType&)>>(fn);
@@ -212,26 +283,53 @@ namespace fserv {
             const std::function<
                 void(ClientSessionType&, const char*, const int)>& fn)
         {
-            std::lock_guard<std::mutex> lock_callback_access(
+            std::lock_guard<util::Mutex> lock_callback_access(
                 lock_callback_access_);
             on_data_received_ = std::make_shared<std::function<void(
                 ClientSessionType&, const char*, const int)>>(fn);
         }
 
+        //! Binds read-into buffer filled callback.
+        //! @param fn
+        //!     Callback function
+        void bind_read_completed_callback(
+            const std::function<void(ClientSessionType&, char*, const int)>&
+                fn)
+        {
+            std::lock_guard<util::Mutex> lock_callback_access(
+                lock_callback_access_);
+            on_read_completed_ = std::make_shared<
+                std::function<void(ClientSessionType&, char*, const int)>>(fn);
+        }
+
+        //! Binds zero-copy data received callback.
+        //! @param fn
+        //!     Callback function
+        void bind_zerocopy_received_callback(
+            const std::function<
+                void(ClientSessionType&, const char*, const int)>& fn)
+        {
+            std::lock_guard<util::Mutex> lock_callback_access(
+                lock_callback_access_);
+            on_zerocopy_received_ = std::make_shared<std::function<void(
+                ClientSessionType&, const char*, const int)>>(fn);
+        }
+
         //! Binds out-of-band data received callback.
         //! @param fn
         //!     Callback function
         void bind_oob_received_callback(
             const std::function<void(ClientSessionType&, char)>& fn)
         {
-            std::lock_guard<std::mutex> lock_callback_access(
+            std::lock_guard<util::Mutex> lock_callback_access(
                 lock_callback_access_);
             on_oob_received_ = std::make_shared<
                 std::function<void(ClientSessionType&, char)>>(fn);
         }
     private:
         /*! Primary access lock */
-        std::mutex lock_callback_access_;
+        util::Mutex lock_callback_access_{
+            "BasicClientHandler::lock_callback_access_"};
 
         /*! Event handler */
         std::shared_ptr<ClientClosedCallbackType> on_client_error_;
@@ -245,6 +343,12 @@ namespace fserv {
         /*! Event handler */
         std::shared_ptr<DataReceivedCallbackType> on_data_received_;
 
+        /*! Event handler */
+        std::shared_ptr<ReadCompletedCallbackType> on_read_completed_;
+
+        /*! Event handler */
+        std::shared_ptr<ZeroCopyReceivedCallbackType> on_zerocopy_received_;
+
         /*! Event handler */
         std::shared_ptr<OobReceivedCallbackType> on_oob_received_;
     };
@@ -7,6 +7,7 @@
 #include "client_session.hpp"
 #include "server_pool.hpp"
 #include <memory>
+#include <utility>
 
 namespace fserv {
 
@@ -73,6 +74,24 @@ namespace fserv {
             client_pool_->bind_data_received_callback(fn);
         }
 
+        /*! @brief Forwards event handler assignment
+         */
+        void bind_client_read_completed_callback(
+            const std::function<void(ClientSessionType&, char*, const int)>&
+                fn)
+        {
+            client_pool_->bind_read_completed_callback(fn);
+        }
+
+        /*! @brief Forwards event handler assignment
+         */
+        void bind_client_zerocopy_received_callback(
+            const std::function<
+                void(ClientSessionType&, const char*, const int)>& fn)
+        {
+            client_pool_->bind_zerocopy_received_callback(fn);
+        }
+
         /*! @brief Forwards event handler assignment
          */
         void bind_oob_received_callback(
@@ -81,6 +100,39 @@ namespace fserv {
             client_pool_->bind_oob_received_callback(fn);
         }
 
+        /*! @brief Forwards event handler assignment, called when listeners
+         *! are found to drop connections
+         */
+        void bind_listen_overflow_callback(
+            const std::function<void(const ListenerMetrics&)>& fn)
+        {
+            server_pool_->set_overflow_handler(fn);
+        }
+
+        /*! @brief Forwards event handler assignment, called when a worker is
+         *! found stalled
+         */
+        void bind_stall_callback(
+            const std::function<void(const StallReport&)>& fn)
+        {
+            server_pool_->set_stall_handler(fn);
+        }
+
+        /*! @brief Sets client connection tunables, applied on next run
+         */
+        void set_client_options(const ClientOptions& options)
+        {
+            server_pool_->set_client_options(options);
+        }
+
+        /*! @brief Sets the period of listener health checks (ms), zero to
+         *! disable, applied on next run
+         */
+        void set_health_interval(int interval)
+        {
+            server_pool_->set_health_interval(interval);
+        }
+
         /*! @brief Enters run loop
          */
         void run(int worker_count = kMaxWorkerCount,
@@ -90,6 +142,74 @@ namespace fserv {
             server_pool_->run(worker_count, max_client_count, timeout_interval);
         }
 
+        /*! @brief Index of the worker running the caller, such as from a
+         *! handler, -1 if the caller is not a worker
+         */
+        static int worker()
+        {
+            return ServerHandler::worker();
+        }
+
+        /*! @brief Number of clients retired for reaching their maximum age
+         */
+        std::uint64_t retired_client_count() const
+        {
+            return server_pool_->retired_client_count();
+        }
+
+        /*! @brief Distributions of the TCP_INFO samples taken so far
+         */
+        TcpMetrics tcp_metrics() const
+        {
+            return server_pool_->tcp_metrics();
+        }
+
+        /*! @brief Relays started by ClientSession::proxy so far, and the
+         *! bytes they moved
+         */
+        RelayMetrics relay_metrics() const
+        {
+            return server_pool_->relay_metrics();
+        }
+
+        /*! @brief Health of the listener sockets
+         */
+        ListenerMetrics listener_metrics() const
+        {
+            return server_pool_->listener_metrics();
+        }
+
+        /*! @brief Recent events of each worker, then of the listening
+         *! thread, oldest first
+         */
+        std::vector<std::vector<TraceRecord>> trace_snapshot() const
+        {
+            return server_pool_->trace_snapshot();
+        }
+
+        /*! @brief Writes the recent events of each worker, then of the
+         *! listening thread, as text
+         */
+        void dump_trace(int fd) const
+        {
+            server_pool_->dump_trace(fd);
+        }
+
+        /*! @brief Contention of the fserv mutexes, per declaration site,
+         *! empty unless built with FSERV_PROFILE_LOCKS
+         */
+        std::vector<LockSiteMetrics> lock_metrics() const
+        {
+            return server_pool_->lock_metrics();
+        }
+
+        /*! @brief Workers found stalled so far
+         */
+        StallMetrics stall_metrics() const
+        {
+            return server_pool_->stall_metrics();
+        }
+
         /*! @brief Stops run loop
          */
         void stop()
@@ -101,7 +221,7 @@ namespace fserv {
          */
         bool bind(int port)
         {
-            std::lock_guard<std::mutex> l(run_access_lock_);
+            std::lock_guard<util::Mutex> l(run_access_lock_);
             return server_pool_->bind(port, kQueueLen);
         }
 
@@ -109,20 +229,66 @@ namespace fserv {
          */
         bool bind(int port, int queue_len)
         {
-            std::lock_guard<std::mutex> l(run_access_lock_);
+            std::lock_guard<util::Mutex> l(run_access_lock_);
             return server_pool_->bind(port, queue_len);
         }
 
+        /*! @brief Creates socket and listens on port, with per-listener
+         *! client deadlines
+         */
+        bool bind(int port, int queue_len, const ClientTimeouts& timeouts)
+        {
+            std::lock_guard<util::Mutex> l(run_access_lock_);
+            return server_pool_->bind(port, queue_len, timeouts);
+        }
+
+        /*! @brief Starts an outbound connection while running, served by the
+         *! same workers and handlers as accepted clients. The callback,
+         *! taking the session and an errno value, zero once established, is
+         *! called before any other handler of the connection.
+         */
+        template <typename FnType>
+        bool connect(const char* ipaddr, int port, FnType&& fn)
+        {
+            return server_pool_->connect(
+                util::endpoint_address(ipaddr, port),
+                ConnectCallback<ClientType>(std::forward<FnType>(fn)));
+        }
+
+        /*! @brief Starts an outbound connection while running, with
+         *! per-connection deadlines
+         */
+        template <typename FnType>
+        bool connect(const char* ipaddr,
+                     int port,
+                     const ClientTimeouts& timeouts,
+                     FnType&& fn)
+        {
+            return server_pool_->connect(
+                util::endpoint_address(ipaddr, port),
+                ConnectCallback<ClientType>(std::forward<FnType>(fn)),
+                timeouts);
+        }
+
         /*! @brief Listens on existing socket
          */
         bool add(int sfd)
         {
-            std::lock_guard<std::mutex> l(run_access_lock_);
+            std::lock_guard<util::Mutex> l(run_access_lock_);
             return server_pool_->add(sfd);
         }
+
+        /*! @brief Listens on existing socket, with per-listener client
+         *! deadlines
+         */
+        bool add(int sfd, const ClientTimeouts& timeouts)
+        {
+            std::lock_guard<util::Mutex> l(run_access_lock_);
+            return server_pool_->add(sfd, timeouts);
+        }
     private:
         // Primary access lock
-        std::mutex run_access_lock_;
+        util::Mutex run_access_lock_{"BasicServer::run_access_lock_"};
 
         // Client handler backend
         std::unique_ptr<ClientHandler> client_pool_;
@@ -0,0 +1,138 @@
+/* buffer_pool.hpp -- v1.0
+   Size-class pool of reusable byte buffers */
+
+#pragma once
+
+#include "mutex.hpp"
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace fserv::util {
+
+    //! @class BufferPool
+    /*! Recycles byte buffers in power-of-two size classes, ranging from
+     *! kMinClassSize to kMaxClassSize
+     */
+    class BufferPool {
+    public:
+        // Smallest buffer size
+        static constexpr int kMinClassSize = 1024;
+        // Number of size classes
+        static constexpr int kClassCount = 9;
+        // Largest buffer size
+        static constexpr int kMaxClassSize = kMinClassSize
+                                             << (kClassCount - 1);
+
+        //! Dtor.
+        ~BufferPool()
+        {
+            for (auto& size_class: classes_) {
+                for (char* buff: size_class.free_buffs) {
+                    std::free(buff);
+                }
+            }
+        }
+
+        //! Ctor.
+        BufferPool() = default;
+
+        //! @param size_class
+        //!     Size class index
+        //! @return
+        //!     Size in bytes of the buffers in the given class
+        static int class_size(int size_class)
+        {
+            return kMinClassSize << size_class;
+        }
+
+        //! @param size
+        //!     Size in bytes
+        //! @return
+        //!     Index of the smallest class holding the given size, capped to
+        //!     the largest class
+        static int class_of(int size)
+        {
+            int size_class = 0;
+            while (size_class + 1 < kClassCount
+                   && class_size(size_class) < size) {
+                ++size_class;
+            }
+
+            return size_class;
+        }
+
+        //! Takes a buffer from the given class, allocating if none is free.
+        //! @param size_class
+        //!     Size class index
+        //! @return
+        //!     Buffer of class_size(size_class) bytes, nullptr on failure
+        char* acquire(int size_class)
+        {
+            auto& pool = classes_[size_class];
+
+            {
+                std::lock_guard<Mutex> l(pool.access_lock);
+                if (!pool.free_buffs.empty()) {
+                    char* buff = pool.free_buffs.back();
+                    pool.free_buffs.pop_back();
+                    return buff;
+                }
+            }
+
+            return static_cast<char*>(std::malloc(class_size(size_class)));
+        }
+
+        //! Returns a buffer to its class.
+        //! Buffers beyond the class retention limit are freed.
+        //! @param buff
+        //!     Buffer previously taken from acquire()
+        //! @param size_class
+        //!     Size class index the buffer was acquired from
+        void release(char* buff, int size_class)
+        {
+            if (buff == nullptr) {
+                return;
+            }
+
+            auto& pool = classes_[size_class];
+
+            {
+                std::lock_guard<Mutex> l(pool.access_lock);
+                if (static_cast<int>(pool.free_buffs.size())
+                    < retained_count(size_class)) {
+                    pool.free_buffs.push_back(buff);
+                    return;
+                }
+            }
+
+            std::free(buff);
+        }
+
+        // Non-copyable object
+        BufferPool(const BufferPool&) = delete;
+        BufferPool& operator=(const BufferPool&) = delete;
+    private:
+        // Bytes kept in reserve per class
+        static constexpr int kRetainedBytes = 4 * 1024 * 1024;
+        // Buffers kept in reserve per class, at least
+        static constexpr int kMinRetainedCount = 4;
+
+        //! @struct SizeClass
+        /*! Free buffers of a single size class
+         */
+        struct SizeClass {
+            Mutex access_lock{"BufferPool::access_lock"};
+            std::vector<char*> free_buffs;
+        };
+
+        /* @helper */
+        static int retained_count(int size_class)
+        {
+            const int count = kRetainedBytes / class_size(size_class);
+            return count < kMinRetainedCount ? kMinRetainedCount : count;
+        }
+
+        SizeClass classes_[kClassCount];
+    };
+} // namespace fserv::util
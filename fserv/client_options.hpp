@@ -0,0 +1,167 @@
+/* client_options.hpp -- v1.0
+   Tunables applied to client connections managed by a client pool */
+
+#pragma once
+
+#include "framing.hpp"
+
+namespace fserv {
+
+    //! @struct ClientOptions
+    /*! Client connection tunables, set on the client pool before it is run
+     */
+    struct ClientOptions {
+        // Treats a read that returns less than the requested size as having
+        // drained the socket, skipping the trailing recv() that would only
+        // return EAGAIN. Safe under edge-triggered one-shot notification, as
+        // rearming re-polls the socket and reports any data that arrived in
+        // the meantime.
+        bool short_read = false;
+
+        // Grows or shrinks each client's read buffer based on its recent read
+        // sizes and the number of bytes pending on the socket. Buffers are
+        // drawn from size-class pools shared by all clients.
+        bool adaptive_read_buffer = false;
+
+        // Upper bound on the adaptive read buffer size (bytes)
+        int max_read_size = 256 * 1024;
+
+        // Splits the byte stream into messages, so that the data handler is
+        // only called with complete messages. Unset by default, handing the
+        // data handler raw reads.
+        AnyFramer framer;
+
+        // Reads into a per-client mirrored ring of this size (bytes) instead
+        // of a pooled buffer, zero to disable. Messages split across reads
+        // are then framed in place in the ring rather than copied out, at
+        // the cost of one memory mapping per client. The ring must be
+        // larger than the largest framed message.
+        int read_ring_size = 0;
+
+        // Maps received pages into a per-client region of this size (bytes)
+        // with TCP_ZEROCOPY_RECEIVE instead of copying them, zero to disable.
+        // Mapped spans go to the zero-copy received handler and stay valid
+        // until released through the session. Partial pages, and data that
+        // arrives while a span is held, are copied and go to the data handler
+        // as usual. Falls back to copying if the socket does not support it.
+        // Ignored for framed clients.
+        int zerocopy_receive_size = 0;
+
+        // Socket receive low watermark (bytes, SO_RCVLOWAT), so that a client
+        // is only woken once this many bytes are queued, zero for the kernel
+        // default. Typically the size of the protocol's fixed header. Data
+        // below the watermark is not reported until more arrives or the peer
+        // closes, so no message may be smaller.
+        int receive_low_watermark = 0;
+
+        // Raises the receive low watermark to the number of bytes missing
+        // from a partially-received framed message or read-into buffer, when
+        // known, so that a message arriving in many fragments wakes a worker
+        // once. Capped at 64 KiB.
+        bool adaptive_receive_low_watermark = false;
+
+        // Appends writes made to a client from its own handlers to an output
+        // buffer, sent with a single send() once the handler returns, rather
+        // than sending each write as it is made. Writes from anywhere else
+        // are sent immediately.
+        bool cork_writes = false;
+
+        // Output buffer size (bytes) at which corked writes are sent without
+        // waiting for the handler to return
+        int cork_flush_size = 64 * 1024;
+
+        // Queues whatever part of a write the socket cannot take, rather
+        // than leaving it unwritten, and sends it as the socket becomes
+        // writable. Queued messages not yet started can still be overtaken
+        // by urgent writes or dropped through the session.
+        bool queue_writes = false;
+
+        // Maximum number of unsent bytes left to the kernel (bytes,
+        // TCP_NOTSENT_LOWAT), zero for the kernel default. Keeps the rest
+        // queued in user space, where urgent writes can overtake it, instead
+        // of behind a large socket send buffer. Used with queue_writes.
+        int notsent_low_watermark = 0;
+
+        // Queued output size (bytes) above which a client's reads are paused,
+        // so that a client sending requests faster than it reads responses
+        // cannot grow its queue without bound, zero to disable. Implies
+        // queue_writes.
+        int output_high_watermark = 0;
+
+        // Queued output size (bytes) at or below which paused reads resume
+        int output_low_watermark = 0;
+
+        // Capacity (bytes) of each of the two pipes a relay splices through,
+        // see ClientSession::proxy, zero for the kernel default of 64 KiB.
+        // Capped by /proc/sys/fs/pipe-max-size.
+        int relay_pipe_size = 0;
+
+        // Period (ms) over which every client's TCP_INFO is sampled once,
+        // zero to disable. Samples are recorded in the pool's TCP metrics and
+        // kept per client, readable through the session.
+        int tcp_info_interval = 0;
+
+        // Maximum number of clients sampled at a time. Batches are spread
+        // over the period, each sampled by whichever worker the timer wakes,
+        // skipping clients other workers are serving.
+        int tcp_info_batch = 64;
+
+        // Time (ms) a worker may spend serving one client, in its handlers
+        // and callbacks, before it is reported as stalled, zero to disable.
+        // Checked by a watchdog thread every half threshold.
+        int stall_threshold = 0;
+
+        // Signal sent to a stalled worker to capture its backtrace, zero to
+        // not capture one. Must not otherwise be used by the application,
+        // such as SIGRTMIN + 1.
+        int stall_signal = 0;
+
+        // Number of recent events (accept, read, write, rearm, close and
+        // timeout) kept per worker in a trace ring, zero to disable.
+        // Rounded up to a power of two.
+        int trace_ring_size = 0;
+
+        // Signal on which the trace rings of all running pools are dumped to
+        // stderr, zero for none. Must not otherwise be used by the
+        // application, such as SIGRTMIN + 2.
+        int trace_dump_signal = 0;
+    };
+
+    //! @struct ClientTimeouts
+    /*! Deadlines after which a client is shut down, set per listener. Each
+     *! is in milliseconds, zero to disable.
+     */
+    struct ClientTimeouts {
+        // From accept, or from the start of an outbound connect, until the
+        // first byte is received
+        int first_byte = 0;
+
+        // From the start of an outbound connect until it is established
+        int connect = 0;
+
+        // Since the client's last event. Defaults to the pool's timeout
+        // interval.
+        int idle = 0;
+
+        // From the first byte of a message until it is complete, for framed
+        // clients and read-into buffers. Bytes trickling in do not extend
+        // it, unlike the idle timeout.
+        int read = 0;
+
+        // Since queued output last drained, or last made progress
+        int write = 0;
+
+        // Connection age after which the client is retired, once no request
+        // is in progress: its write side is shut down, for the peer to
+        // reconnect, possibly to another instance. Unlike the deadlines
+        // above, this is a graceful close.
+        int max_age = 0;
+
+        // Random amount taken off each client's maximum age, so that
+        // connections accepted together do not all reconnect together
+        int max_age_jitter = 0;
+
+        // Time a retired client is given to close before it is shut down
+        int max_age_grace = 0;
+    };
+} // namespace fserv
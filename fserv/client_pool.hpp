@@ -5,13 +5,28 @@
 #pragma once
 
 #include "atomic_stack.hpp"
+#include "client_options.hpp"
 #include "client_session.hpp"
 #include "client_session_manager.hpp"
+#include "coarse_clock.hpp"
 #include "endpoint.hpp"
 #include "epoll.hpp"
+#include "metrics.hpp"
+#include "mutex.hpp"
 #include "std_memory.hpp"
-#include "timeout_timer.hpp"
+#include "timer_wheel.hpp"
+#include "trace.hpp"
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <execinfo.h>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <random>
 #include <thread>
 #include <type_traits>
 #include <vector>
@@ -68,6 +83,30 @@ namespace fserv {
         }
     };
 
+    template <typename DerivedType, typename ClientType>
+    struct enable_client_read_completed {
+        //! SFINAE
+        void client_read_completed(ClientSession<ClientType>& client,
+                                   char* buff,
+                                   const int size)
+        {
+            static_cast<DerivedType*>(this)->client_read_completed(
+                client, buff, size);
+        }
+    };
+
+    template <typename DerivedType, typename ClientType>
+    struct enable_client_zerocopy_received {
+        //! SFINAE
+        void client_zerocopy_received(ClientSession<ClientType>& client,
+                                      const char* data,
+                                      const int size)
+        {
+            static_cast<DerivedType*>(this)->client_zerocopy_received(
+                client, data, size);
+        }
+    };
+
     //! @class ClientPool
     /*! Encapsulates event handling of multiple clients
      */
@@ -84,9 +123,14 @@ namespace fserv {
         //! Adds a new client.
         //! @param sfd
         //!     Socket file descriptor
+        //! @param timeouts
+        //!     Client deadlines, the idle timeout defaulting to the pool's
+        //!     timeout interval
         //! @return
         //!     The newly-allocated client
-        ClientType* add_client(int sfd)
+        ClientType* add_client(
+            int sfd,
+            const ClientTimeouts& timeouts = ClientTimeouts())
         {
             auto* node = clients_stack_.pop();
             if (node == nullptr) {
@@ -95,17 +139,99 @@ namespace fserv {
 
             auto* client = new (node) ClientType(sfd, this);
             static_cast<util::StackNode<ClientType>*>(client)->sfd = sfd;
+            slot_of(client).connecting.store(false, std::memory_order_relaxed);
+            accepted_client_ = client;
             have_client_accepted(client);
+            accepted_client_ = nullptr;
 
-            constexpr int kFlags = EPOLLIN | EPOLLET | EPOLLHUP | EPOLLRDHUP
-                                   | EPOLLPRI | EPOLLONESHOT;
-            if (!epoll_.add(client, sfd, kFlags)) {
-                return terminate(client), nullptr;
+            int flags = EPOLLIN | EPOLLET | EPOLLHUP | EPOLLRDHUP | EPOLLPRI
+                        | EPOLLONESHOT;
+
+            // A relay requested by the accepted handler connects as the
+            // client is first served, which writability triggers at once
+            if (client->pending_output_size() > 0
+                || slot_of(client).relay != nullptr) {
+                flags |= EPOLLOUT;
+            }
+
+            return register_client(client, timeouts, flags, true);
+        }
+
+        //! Starts an outbound connection, registered as a client once
+        //! established. May be called from any thread while the pool runs,
+        //! including from a handler.
+        //! @param addr
+        //!     Remote address
+        //! @param callback
+        //!     Called from a worker once the connection is established,
+        //!     before any other handler, or once it has failed, after which
+        //!     the client is closed without further callbacks
+        //! @param timeouts
+        //!     Client deadlines, the idle timeout defaulting to the pool's
+        //!     timeout interval
+        //! @return
+        //!     The newly-allocated client, or null if the connect could not
+        //!     be started, in which case the callback is not called
+        ClientType* connect_client(
+            const sockaddr_in& addr,
+            ConnectCallback<ClientType>&& callback,
+            const ClientTimeouts& timeouts = ClientTimeouts())
+        {
+            const int sfd = util::endpoint_tcp();
+            if (sfd == -1) {
+                return nullptr;
             }
 
-            timeout_timer_.set(client);
+            if (util::endpoint_unblock(sfd) == -1
+                || (util::endpoint_connect(sfd, addr) == -1
+                    && errno != EINPROGRESS)) {
+                return util::endpoint_close(sfd), nullptr;
+            }
 
-            return client;
+            auto* node = clients_stack_.pop();
+            if (node == nullptr) {
+                return util::endpoint_close(sfd), nullptr;
+            }
+
+            auto* client = new (node) ClientType(sfd, this);
+            static_cast<util::StackNode<ClientType>*>(client)->sfd = sfd;
+
+            ClientSlot& slot = slot_of(client);
+            slot.on_connected = std::move(callback);
+            slot.connect_error = 0;
+            slot.connecting.store(true, std::memory_order_relaxed);
+
+            // The socket turns writable once the connect completes, even if
+            // it already has
+            const int flags
+                = EPOLLOUT | EPOLLET | EPOLLHUP | EPOLLRDHUP | EPOLLONESHOT;
+            return register_client(client, timeouts, flags, false);
+        }
+
+        //! Sets the tunables applied to client connections.
+        //! Ignored while the pool is running.
+        //! @param options
+        //!     Client connection tunables
+        void set_options(const ClientOptions& options)
+        {
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+            if (threads_.empty()) {
+                options_ = options;
+            }
+        }
+
+        //! Sets the handler called from the watchdog thread when a worker is
+        //! found stalled, see ClientOptions::stall_threshold.
+        //! Ignored while the pool is running.
+        //! @param fn
+        //!     Handler, passed the stall found
+        void set_stall_handler(
+            const std::function<void(const StallReport&)>& fn)
+        {
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+            if (threads_.empty()) {
+                stall_handler_ = fn;
+            }
         }
 
         //! Initializes and starts the pool.
@@ -116,36 +242,103 @@ namespace fserv {
         //! @param timeout_interval
         //!     Client inactivity timeout interval
         //! @return
-        //!     True if the pool is successfully started, false otherwise
+        //!     True if the pool is successfully started, false if already
+        //!     running or if either count is not positive
         bool run(int worker_count, int max_client_count, int timeout_interval)
         {
-            std::lock_guard<std::mutex> l(status_check_lock_);
+            std::lock_guard<util::Mutex> l(status_check_lock_);
 
             // Only proceed if not already in running instance
             if (!threads_.empty()) {
                 return false;
             }
 
+            if (worker_count <= 0 || max_client_count <= 0) {
+                return false;
+            }
+
             // Allocate clients buffer
-            if (!init(mem_pool_, max_client_count)) {
+            if (!init(mem_pool_, max_client_count)
+                || mem_pool_.capacity <= 0) {
                 throw std::bad_alloc();
             }
 
-            if (timeout_interval > 0) {
-                const auto fn =
-                    [this](const std::vector<ClientType*>& timed_out_clients) {
-                        for (auto* client: timed_out_clients) {
-                            terminate_on_close(client);
-                        }
-                    };
+            slots_ = std::make_unique<ClientSlot[]>(
+                static_cast<std::size_t>(mem_pool_.capacity));
+
+            // Timeouts and session callbacks expire from the worker loop,
+            // through a timer registered with the epoll instance
+            if (!epoll_.enable_timer()) {
+                throw std::runtime_error("Failed to create timer descriptor");
+            }
 
-                timeout_timer_.run(timeout_interval, fn);
+            timeout_interval_ = timeout_interval > 0 ? timeout_interval : 0;
+            timers_ = Wheel(now_ms());
+            timer_deadline_ = -1;
+
+            if (options_.tcp_info_interval > 0) {
+                live_.reserve(mem_pool_.capacity);
+                live_cursor_ = 0;
+
+                std::lock_guard<util::Mutex> timers_lock(timers_lock_);
+                schedule(now_ms() + options_.tcp_info_interval,
+                         TimerKey{kSampler, kNoRecord});
+            }
+
+            // Workers publish the client they serve, for the watchdog to
+            // find stalls
+            if (options_.stall_threshold > 0) {
+                workers_ = std::make_unique<WorkerActivity[]>(
+                    static_cast<std::size_t>(worker_count));
+                if (options_.stall_signal != 0) {
+                    install_backtrace_handler(options_.stall_signal);
+                }
+            }
+
+            // Each worker records its recent events in a ring of its own
+            trace_rings_.clear();
+            if (options_.trace_ring_size > 0) {
+                for (int i = 0; i != worker_count; ++i) {
+                    trace_rings_.push_back(std::make_unique<util::TraceRing>(
+                        options_.trace_ring_size));
+                    util::TraceRegistry::add(trace_rings_.back().get());
+                }
+
+                if (options_.trace_dump_signal != 0) {
+                    util::TraceRegistry::install_dump_handler(
+                        options_.trace_dump_signal);
+                }
             }
 
             clients_stack_.init(mem_pool_);
             for (int i = 0; i != worker_count; ++i) {
-                threads_.emplace_back([&] {
+                threads_.emplace_back([this, i] {
+                    // Splicing into a socket reset by the peer raises
+                    // SIGPIPE, which splice() has no flag to suppress
+                    sigset_t sigpipe;
+                    sigemptyset(&sigpipe);
+                    sigaddset(&sigpipe, SIGPIPE);
+                    pthread_sigmask(SIG_BLOCK, &sigpipe, nullptr);
+
+                    worker_index_ = i;
+                    worker_ = workers_ ? &workers_[i] : nullptr;
+                    util::TraceRing::set_current(
+                        trace_rings_.empty() ? nullptr : trace_rings_[i].get());
                     epoll_.wait(this);
+                    util::TraceRing::set_current(nullptr);
+                    worker_ = nullptr;
+                    worker_index_ = -1;
+                });
+
+                if (workers_) {
+                    workers_[i].thread = threads_.back().native_handle();
+                }
+            }
+
+            if (workers_) {
+                watchdog_stop_ = false;
+                watchdog_ = std::thread([this, worker_count] {
+                    watch(worker_count);
                 });
             }
 
@@ -155,13 +348,21 @@ namespace fserv {
         //! Stops running worker instances.
         void stop()
         {
-            std::lock_guard<std::mutex> l(status_check_lock_);
+            std::lock_guard<util::Mutex> l(status_check_lock_);
 
             if (threads_.empty()) {
                 return;
             }
 
-            timeout_timer_.stop();
+            if (watchdog_.joinable()) {
+                {
+                    std::lock_guard<std::mutex> watchdog_lock(watchdog_lock_);
+                    watchdog_stop_ = true;
+                }
+
+                watchdog_wake_.notify_all();
+                watchdog_.join();
+            }
 
             // Master thread initiates the shutdown daisy-chain
             epoll_.close();
@@ -170,6 +371,12 @@ namespace fserv {
             }
 
             threads_.clear();
+            workers_.reset();
+
+            // Rings are kept for inspection until the next run
+            for (const auto& ring: trace_rings_) {
+                util::TraceRegistry::remove(ring.get());
+            }
 
             // Reset active clients...
             for (int i = 0; i != mem_pool_.capacity; ++i) {
@@ -180,6 +387,10 @@ namespace fserv {
 
             // Clean up
             destroy(mem_pool_);
+            slots_.reset();
+            timer_records_.clear();
+            free_record_ = kNoRecord;
+            live_.clear();
         }
 
         //! Reactivates client for next read.
@@ -198,6 +409,207 @@ namespace fserv {
         //! @param flags
         //!     Epoll event flags
         void trigger(ClientType* client, int flags);
+
+        //! Expires due timers, and runs expired callbacks.
+        void timer_triggered();
+
+        //! Schedules a callback on a client.
+        //! @param client
+        //!     Client to run the callback for
+        //! @param delay
+        //!     Delay before the first run
+        //! @param interval
+        //!     Delay between runs, zero to run once
+        //! @param callback
+        //!     Callback to run
+        //! @return
+        //!     Identifier to cancel the callback with
+        TimerId schedule_timer(ClientType* client,
+                               std::chrono::milliseconds delay,
+                               std::chrono::milliseconds interval,
+                               TimerCallback<ClientType>&& callback) override;
+
+        //! Cancels a scheduled callback.
+        //! @param client
+        //!     Client the callback was scheduled on
+        //! @param id
+        //!     Callback identifier, ignored if no longer scheduled
+        void cancel_timer(ClientType* client, TimerId id) override;
+
+        //! @return
+        //!     Tunables applied to client connections
+        const ClientOptions& options() const override
+        {
+            return options_;
+        }
+
+        //! @return
+        //!     Pool from which client read buffers are drawn
+        util::BufferPool* buffer_pool() override
+        {
+            return &buffer_pool_;
+        }
+
+        //! Routes a client's data and close events to a handler.
+        //! @param client
+        //!     Client, served by the calling worker
+        //! @param handler
+        //!     Event handler, null for the packet sink
+        void set_event_handler(ClientType* client,
+                               ClientEventHandler<ClientType>* handler) override
+        {
+            slot_of(client).handler = handler;
+        }
+
+        //! Relays a client to a new outbound connection, see
+        //! ClientSession::proxy.
+        //! @param client
+        //!     Client, served by the calling worker or being accepted
+        //! @param addr
+        //!     Remote address
+        //! @param timeouts
+        //!     Deadlines of the outbound connection
+        //! @return
+        //!     False if the connect could not be started
+        bool proxy(ClientType* client,
+                   const sockaddr_in& addr,
+                   const ClientTimeouts& timeouts) override
+        {
+            ClientSlot& slot = slot_of(client);
+            if (slot.relay != nullptr || is_closed(client)) {
+                return false;
+            }
+
+            auto relay = std::make_unique<Relay>();
+            for (RelayDirection& direction: relay->directions) {
+                relay->pipe_size = util::endpoint_pipe(
+                    direction.pipe, options_.relay_pipe_size);
+                if (relay->pipe_size == -1) {
+                    return false;
+                }
+            }
+
+            relay->clients[0] = client;
+            relay->uuids[0]
+                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+            relay->sfds[0]
+                = static_cast<util::StackNode<ClientType>*>(client)->sfd;
+            relay->queued[0].store(client->pending_output_size() > 0,
+                                   std::memory_order_relaxed);
+            relay->address = addr;
+            relay->timeouts = timeouts;
+
+            // Nothing is read from the client until the connect completes
+            relay->directions[0].blocked.store(true, std::memory_order_relaxed);
+
+            slot.relay = relay.get();
+            slot.relay_side = 0;
+
+            // Not registered yet, the connect waits for a worker to serve
+            // the client, see add_client
+            if (client == accepted_client_) {
+                relay->deferred = true;
+                relay.release();
+                relay_count_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            if (!start_relay(relay.get())) {
+                slot.relay = nullptr;
+                return false;
+            }
+
+            relay.release();
+            relay_count_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        //! @return
+        //!     Index of the worker running the caller, -1 if the caller is
+        //!     not a worker of a running pool
+        static int worker()
+        {
+            return worker_index_;
+        }
+
+        //! @return
+        //!     Relays started so far, and the bytes they moved
+        RelayMetrics relay_metrics() const
+        {
+            RelayMetrics metrics;
+            metrics.relay_count = relay_count_.load(std::memory_order_relaxed);
+            metrics.failure_count
+                = relay_failure_count_.load(std::memory_order_relaxed);
+            metrics.relayed_bytes
+                = relayed_bytes_.load(std::memory_order_relaxed);
+            return metrics;
+        }
+
+        //! @return
+        //!     Number of clients retired for reaching their maximum age
+        std::uint64_t retired_client_count() const
+        {
+            return retired_count_.load(std::memory_order_relaxed);
+        }
+
+        //! @param client
+        //!     Client, served by the calling worker
+        //! @return
+        //!     Client's latest TCP_INFO sample
+        TcpSample tcp_sample(ClientType* client) override
+        {
+            return slot_of(client).tcp;
+        }
+
+        //! @return
+        //!     Distributions of the TCP_INFO samples taken so far
+        TcpMetrics tcp_metrics() const
+        {
+            TcpMetrics metrics;
+            metrics.sample_count
+                = tcp_sample_count_.load(std::memory_order_relaxed);
+            metrics.rtt = tcp_rtt_.snapshot();
+            metrics.cwnd = tcp_cwnd_.snapshot();
+            metrics.retransmits = tcp_retransmits_.snapshot();
+            metrics.unacked = tcp_unacked_.snapshot();
+            return metrics;
+        }
+
+        //! @return
+        //!     Recent events of each worker, oldest first, empty if tracing
+        //!     is disabled
+        std::vector<std::vector<TraceRecord>> trace_snapshot() const
+        {
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+
+            std::vector<std::vector<TraceRecord>> snapshot;
+            for (const auto& ring: trace_rings_) {
+                snapshot.push_back(ring->snapshot());
+            }
+
+            return snapshot;
+        }
+
+        //! Writes the recent events of each worker as text.
+        //! @param fd
+        //!     File descriptor
+        void dump_trace(int fd) const
+        {
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+            for (std::size_t i = 0; i != trace_rings_.size(); ++i) {
+                trace_rings_[i]->dump(fd, static_cast<int>(i));
+            }
+        }
+
+        //! @return
+        //!     Workers found stalled so far
+        StallMetrics stall_metrics() const
+        {
+            StallMetrics metrics;
+            metrics.stall_count = stall_count_.load(std::memory_order_relaxed);
+            metrics.durations = stall_durations_.snapshot();
+            return metrics;
+        }
     private:
         // Epoll instance that handles all triggered client events
         EpollWaiter<ClientPool<PacketSinkType, ClientType>, ClientType> epoll_;
@@ -211,282 +623,2540 @@ namespace fserv {
         PacketSinkType* packet_sink_;
         // Current running worker threads
         std::vector<std::thread> threads_;
-        // Runs in background to check for inactive clients
-        TimeoutTimer<ClientType> timeout_timer_;
+        // Client connection tunables
+        ClientOptions options_;
+        // Client read buffers
+        util::BufferPool buffer_pool_;
+
+        // No timer record
+        static constexpr std::uint32_t kNoRecord = ~std::uint32_t(0);
+
+        // Timer key uuid of the TCP_INFO sampler
+        static constexpr int kSampler = -1;
+
+        // Timer key record of a relayed client woken from outside a worker
+        static constexpr std::uint32_t kRelayWakeup = kNoRecord - 1;
+
+        // Client slot state: set while a worker serves the client
+        static constexpr std::uint32_t kBusy = 1u << 31;
+        // Client slot state: set while the client is registered for events
+        static constexpr std::uint32_t kArmed = 1u << 30;
+        // Client slot state: set when callbacks expire while busy
+        static constexpr std::uint32_t kTimersDue = 1u << 29;
+        // Client slot state: set when the client is terminated while busy
+        static constexpr std::uint32_t kTerminateDue = 1u << 28;
+        // Client slot state: events received while busy
+        static constexpr std::uint32_t kEventMask = 0xffff;
+        // Events a relayed client is served with when its relay changes
+        static constexpr std::uint32_t kRelayEvents = EPOLLIN | EPOLLOUT;
+
+        //! @struct TimerKey
+        /*! Client deadline, either the idle timeout or a scheduled callback
+         */
+        struct TimerKey {
+            int uuid = -1;
+            std::uint32_t record = kNoRecord;
+        };
+
+        using Wheel = util::TimerWheel<TimerKey>;
+
+        //! @struct TimerRecord
+        /*! Callback scheduled on a client. Guarded by timers_lock_, apart
+         *! from the callback, which only the worker serving the client runs.
+         */
+        struct TimerRecord {
+            TimerCallback<ClientType> callback;
+            // Delay between runs (ms), zero to run once
+            std::int64_t interval = 0;
+            // Deadline while scheduled, null once expired
+            typename Wheel::Handle handle = Wheel::kNullHandle;
+            // Bumped on release, invalidating outstanding identifiers
+            std::uint32_t sequence = 0;
+            // Client uuid
+            int uuid = -1;
+            // Client's records, or free records through next
+            std::uint32_t prev = kNoRecord;
+            std::uint32_t next = kNoRecord;
+            // Client's expired records, awaiting a run
+            std::uint32_t next_due = kNoRecord;
+            // Set when cancelled after expiry
+            bool cancelled = false;
+            // Set while a worker runs the callback. A record cancelled
+            // meanwhile is unlinked from its client and left for that worker
+            // to release.
+            bool running = false;
+        };
+
+        //! @struct RelayDirection
+        /*! One way of a relay: bytes read from the source client are spliced
+         *! into a pipe, and from the pipe into the sink client
+         */
+        struct RelayDirection {
+            // Pipe read and write ends, -1 if not created
+            int pipe[2] = {-1, -1};
+            // Number of passes requested, the one running included. The
+            // thread raising it from zero runs passes until it drops back.
+            std::atomic<std::uint32_t> passes = 0;
+            // Bytes held in the pipe, owned by the thread running passes
+            int buffered = 0;
+            // Set while the pipe holds bytes the sink cannot take yet
+            std::atomic<bool> blocked = false;
+            // Set once the source has closed its write side
+            std::atomic<bool> eof = false;
+            // Set once the pipe has drained after the end of the source, and
+            // the sink's write side is shut down
+            std::atomic<bool> done = false;
+        };
+
+        //! @struct Relay
+        /*! Pair of clients whose bytes are spliced to each other, the
+         *! proxied client and its outbound connection
+         */
+        struct Relay {
+            ~Relay()
+            {
+                for (RelayDirection& direction: directions) {
+                    for (const int fd: direction.pipe) {
+                        if (fd != -1) {
+                            util::endpoint_close(fd);
+                        }
+                    }
+                }
+
+                for (int side = 0; side != 2; ++side) {
+                    if (kept[side]) {
+                        util::endpoint_close(sfds[side]);
+                    }
+                }
+            }
 
-        mutable std::mutex status_check_lock_;
+            // Clients, null until connected and once closed, guarded by lock
+            ClientType* clients[2] = {};
+            // Client uuids and socket descriptors, set before the clients
+            // take part in passes
+            int uuids[2] = {-1, -1};
+            int sfds[2] = {-1, -1};
+            // Set for the socket of a client that closed while passes of
+            // the failed relay could still use it, closed with the relay
+            bool kept[2] = {};
+            // From each client to the other
+            RelayDirection directions[2];
+            // Capacity of each pipe (bytes)
+            int pipe_size = 0;
+            // Set while output written to a client before the relay started
+            // is still queued, keeping relayed bytes behind it
+            std::atomic<bool> queued[2] = {};
+            // Set until the outbound connection is established
+            std::atomic<bool> connecting = true;
+            // Set once either client fails or closes early, ending the relay
+            std::atomic<bool> failed = false;
+            // Set while the connect waits for the proxied client to be
+            // served, owned by the worker serving it
+            bool deferred = false;
+            // Outbound address and deadlines
+            sockaddr_in address = {};
+            ClientTimeouts timeouts;
+            // Number of references: the clients taking part and a connect
+            // in progress. The last one deletes the relay.
+            std::atomic<int> refs = 1;
+            // Guards clients
+            util::Mutex lock{"ClientPool::Relay::lock"};
+        };
+
+        //! Releases a reference to a relay, deleting it with the last.
+        //! @param relay
+        //!     Relay
+        static void unref(Relay* relay)
+        {
+            if (relay->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete relay;
+            }
+        }
 
-        //! Closes socket and returns client to unused queue.
+        //! @struct RelayUnref
+        /*! Releases a reference to a relay
+         */
+        struct RelayUnref {
+            void operator()(Relay* relay) const
+            {
+                unref(relay);
+            }
+        };
+
+        // Reference to a relay, released as it goes out of scope
+        using RelayRef = std::unique_ptr<Relay, RelayUnref>;
+
+        //! @struct ClientSlot
+        /*! Per-slot client state that outlives the client object
+         */
+        struct ClientSlot {
+            // Time of the client's last event (ms)
+            std::atomic<std::int64_t> last_active = 0;
+            // Serving state, see kBusy, kArmed, kTimersDue, kTerminateDue
+            // and kEventMask
+            std::atomic<std::uint32_t> state = 0;
+            // Time the client was accepted, or its connect started (ms)
+            std::int64_t accepted = 0;
+            // Set while an outbound connect is in progress
+            std::atomic<bool> connecting = false;
+            // Error reported to the connect callback in place of the
+            // socket's, owned by the worker serving the client
+            int connect_error = 0;
+            // Called once an outbound connect completes, owned by the worker
+            // serving the client
+            ConnectCallback<ClientType> on_connected;
+            // Handles the client's data and close events in place of the
+            // packet sink if set, owned by the worker serving the client
+            ClientEventHandler<ClientType>* handler = nullptr;
+            // Set once the handler has been told of the close
+            bool handler_closed = false;
+            // Relay the client takes part in, null if none, owned by the
+            // worker serving the client
+            Relay* relay = nullptr;
+            // Client's side of the relay, zero for the proxied client and
+            // one for its outbound connection
+            int relay_side = 0;
+            // Set once the client's first byte is received
+            std::atomic<bool> received = false;
+            // Time the message being received started (ms), zero if none
+            std::atomic<std::int64_t> message_start = 0;
+            // Time queued output last made progress (ms), zero if none is
+            // queued
+            std::atomic<std::int64_t> write_progress = 0;
+            // Client deadlines, set as the client is added
+            ClientTimeouts timeouts;
+            // Deadline check, guarded by timers_lock_
+            typename Wheel::Handle deadline_timer = Wheel::kNullHandle;
+            // Relay wakeup, guarded by timers_lock_
+            typename Wheel::Handle relay_timer = Wheel::kNullHandle;
+            // Set when a deadline has passed, guarded by timers_lock_
+            bool timed_out = false;
+            // Time the client reaches its maximum age (ms), zero once
+            // reached or if unset, guarded by timers_lock_
+            std::int64_t retire_at = 0;
+            // Set when the maximum age is reached, guarded by timers_lock_
+            bool retire_due = false;
+            // Set while the client waits for its request to complete before
+            // retiring, owned by the worker serving the client
+            bool retiring = false;
+            // Time the client was retired (ms), zero if not retired, guarded
+            // by timers_lock_
+            std::int64_t retired = 0;
+            // Client's records, guarded by timers_lock_
+            std::uint32_t records = kNoRecord;
+            // Client's expired records, guarded by timers_lock_
+            std::uint32_t due_head = kNoRecord;
+            std::uint32_t due_tail = kNoRecord;
+            // Position in live_, -1 if not sampled, guarded by timers_lock_
+            int live_index = -1;
+            // Latest TCP_INFO sample, written by the worker serving the
+            // client
+            TcpSample tcp;
+        };
+
+        // State of each client slot, indexed by uuid
+        std::unique_ptr<ClientSlot[]> slots_;
+        // Client inactivity timeout interval (ms), zero if disabled
+        int timeout_interval_ = 0;
+        // Client deadlines
+        Wheel timers_;
+        // Scheduled callbacks, addresses stable as the container grows
+        std::deque<TimerRecord> timer_records_;
+        // Released callback records, linked through next
+        std::uint32_t free_record_ = kNoRecord;
+        // Time the epoll timer is set to expire at (ms), -1 if disarmed
+        std::int64_t timer_deadline_ = -1;
+        // Guards timers_, timer_records_ and timer_deadline_
+        util::Mutex timers_lock_{"ClientPool::timers_lock_"};
+        // Number of clients retired for reaching their maximum age
+        std::atomic<std::uint64_t> retired_count_ = 0;
+        // Relays started, failed, and bytes moved by relays
+        std::atomic<std::uint64_t> relay_count_ = 0;
+        std::atomic<std::uint64_t> relay_failure_count_ = 0;
+        std::atomic<std::uint64_t> relayed_bytes_ = 0;
+        //! @struct WorkerActivity
+        /*! Client a worker is serving, published for the watchdog
+         */
+        struct WorkerActivity {
+            // Maximum number of frames captured
+            static constexpr int kMaxFrames = 64;
+
+            // Time the worker started serving the client (ms), zero while
+            // the worker waits for events
+            std::atomic<std::int64_t> since = 0;
+            // Uuid of the client being served
+            std::atomic<int> uuid = -1;
+            // Start time of the last serve found stalled (ms), set by the
+            // watchdog
+            std::atomic<std::int64_t> stalled = 0;
+            // Worker thread
+            pthread_t thread = {};
+            // Frames captured by the backtrace signal handler, and their
+            // count, -1 until captured
+            void* frames[kMaxFrames] = {};
+            std::atomic<int> frame_count = -1;
+        };
+
+        // Recent events of each worker, empty if tracing is disabled
+        std::vector<std::unique_ptr<util::TraceRing>> trace_rings_;
+        // Activity of each worker, null if stalls are not watched for
+        std::unique_ptr<WorkerActivity[]> workers_;
+        // Checks workers for stalls
+        std::thread watchdog_;
+        // Wakes the watchdog to stop
+        std::mutex watchdog_lock_;
+        std::condition_variable watchdog_wake_;
+        bool watchdog_stop_ = false;
+        // Called when a worker is found stalled
+        std::function<void(const StallReport&)> stall_handler_;
+        // Number of stalls found
+        std::atomic<std::uint64_t> stall_count_ = 0;
+        // Time stalled workers spent serving their client (ms)
+        util::Histogram stall_durations_;
+
+        // Uuids of the clients sampled for TCP_INFO, in no particular order,
+        // guarded by timers_lock_
+        std::vector<int> live_;
+        // Position in live_ of the next client to sample, guarded by
+        // timers_lock_
+        std::size_t live_cursor_ = 0;
+        // Distributions of the TCP_INFO samples
+        util::Histogram tcp_rtt_;
+        util::Histogram tcp_cwnd_;
+        util::Histogram tcp_retransmits_;
+        util::Histogram tcp_unacked_;
+        std::atomic<std::uint64_t> tcp_sample_count_ = 0;
+
+        // Activity of this worker thread, null if not watched
+        inline static thread_local WorkerActivity* worker_ = nullptr;
+        // Index of this worker thread, -1 if not a worker
+        inline static thread_local int worker_index_ = -1;
+        // Client currently dispatched on this worker thread
+        inline static thread_local ClientType* dispatched_client_ = nullptr;
+        // Set when the dispatched client is rearmed by its handler
+        inline static thread_local bool dispatched_client_rearmed_ = false;
+        // Set when the dispatched client is terminated by its handler
+        inline static thread_local bool dispatched_client_closed_ = false;
+        // Set when read data is handed to a handler of the dispatched client
+        inline static thread_local bool dispatched_client_delivered_ = false;
+        // Set while callbacks of the dispatched client are run
+        inline static thread_local bool dispatched_by_timer_ = false;
+        // Set when the dispatched client is shut down by a callback
+        inline static thread_local bool dispatched_client_shut_down_ = false;
+        // Client whose accepted handler runs on this thread, not yet
+        // registered
+        inline static thread_local ClientType* accepted_client_ = nullptr;
+        // Relayed clients claimed by this worker, served once the current
+        // client is done
+        inline static thread_local std::vector<ClientType*> relay_peers_;
+        // Clients with callbacks expired by this worker
+        inline static thread_local std::vector<int> expired_clients_;
+        // Clients in the TCP_INFO batch taken by this worker
+        inline static thread_local std::vector<int> sampled_clients_;
+        // Relayed clients woken through this worker's timer
+        inline static thread_local std::vector<int> woken_clients_;
+
+        mutable util::Mutex status_check_lock_{
+            "ClientPool::status_check_lock_"};
+
+        //! Serves a client, along with any events received and callbacks
+        //! expired while doing so, then the relayed clients claimed.
         //! @param client
-        //!     To be terminated
-        void terminate_on_close(ClientType* client);
+        //!     Client, entered by this worker
+        //! @param flags
+        //!     Epoll event flags, zero if none
+        //! @param timers_due
+        //!     Whether callbacks of the client have expired
+        void serve(ClientType* client, int flags, bool timers_due);
 
-        //! Closes socket and returns client to unused queue.
+        //! Handles triggered events, then rearms the client.
         //! @param client
-        //!     To be terminated
-        void terminate_on_error(ClientType* client);
+        //!     Triggered client
+        //! @param flags
+        //!     Epoll event flags
+        void dispatch_events(ClientType* client, int flags);
 
-        template <typename q_t = PacketSinkType>
-        typename std::enable_if<
-            !std::is_base_of_v<
-                enable_client_accepted<PacketSinkType, ClientType>,
-                q_t>,
-            void>::type
-        have_client_accepted(ClientType&)
+        //! Checks workers for stalls until stopped.
+        //! @param worker_count
+        //!     Number of workers
+        void watch(int worker_count);
+
+        //! Captures the backtrace of a worker, through the stall signal.
+        //! @param worker
+        //!     Worker activity
+        //! @param frames[out]
+        //!     Return addresses, left empty if not captured in time
+        void capture_backtrace(WorkerActivity& worker,
+                               std::vector<void*>* frames);
+
+        //! Installs the signal handler that captures a worker's backtrace.
+        //! @param signo
+        //!     Signal number
+        static void install_backtrace_handler(int signo)
         {
-            /* Not implemented in packet sink */
+            // Loads the unwinder now, rather than from the signal handler
+            void* frame = nullptr;
+            ::backtrace(&frame, 1);
+
+            struct sigaction action = {};
+            action.sa_handler = [](int) {
+                const int saved_errno = errno;
+                WorkerActivity* worker = worker_;
+                if (worker != nullptr) {
+                    const int n = ::backtrace(worker->frames,
+                                              WorkerActivity::kMaxFrames);
+                    worker->frame_count.store(n, std::memory_order_release);
+                }
+
+                errno = saved_errno;
+            };
+
+            action.sa_flags = SA_RESTART;
+            sigemptyset(&action.sa_mask);
+            ::sigaction(signo, &action, nullptr);
         }
 
+        //! Handles triggered event.
         //! @param client
         //!     Triggered client
-        template <typename q_t = PacketSinkType>
-        typename std::enable_if<
-            std::is_base_of_v<
-                enable_client_accepted<PacketSinkType, ClientType>,
-                q_t>,
-            void>::type
-        have_client_accepted(ClientType* client)
-        {
-            const int uuid
-                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+        //! @param flags
+        //!     Epoll event flags
+        void dispatch(ClientType* client, int flags);
 
-            ClientSession<ClientType> session(client, uuid);
-            packet_sink_->client_accepted(session);
-        }
+        //! Runs the expired callbacks of a client.
+        //! @param client
+        //!     Client, entered by this worker
+        void run_timers(ClientType* client);
 
-        template <typename q_t = PacketSinkType>
-        typename std::enable_if<
-            !std::is_base_of_v<enable_client_closed<PacketSinkType, ClientType>,
-                               q_t>,
-            void>::type
-        have_client_closed(ClientType*)
+        //! @param client
+        //!     Client
+        //! @return
+        //!     State of the client's slot
+        ClientSlot& slot_of(ClientType* client)
         {
-            /* Not implemented in packet sink */
+            return slots_[static_cast<util::StackNode<ClientType>*>(client)
+                              ->uuid];
         }
 
+        //! Sets up a new client's deadlines and registers its socket.
         //! @param client
-        //!     Triggered client
-        template <typename q_t = PacketSinkType>
-        typename std::enable_if<
-            std::is_base_of_v<enable_client_closed<PacketSinkType, ClientType>,
-                              q_t>,
-            void>::type
-        have_client_closed(ClientType* client)
+        //!     New client
+        //! @param timeouts
+        //!     Client deadlines, the idle timeout defaulting to the pool's
+        //!     timeout interval
+        //! @param flags
+        //!     Epoll event flags
+        //! @param read
+        //!     Whether read events are armed
+        //! @return
+        //!     The client, or null if it could not be registered
+        ClientType* register_client(ClientType* client,
+                                    const ClientTimeouts& timeouts,
+                                    int flags,
+                                    bool read)
         {
+            const int sfd
+                = static_cast<util::StackNode<ClientType>*>(client)->sfd;
             const int uuid
                 = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+            ClientSlot& slot = slots_[uuid];
 
-            ClientSession<ClientType> session(client, uuid);
-            packet_sink_->client_closed(session);
+            // Deadlines run from the accept, or the connect, onwards
+            slot.timeouts = timeouts;
+            if (slot.timeouts.idle == 0) {
+                slot.timeouts.idle = timeout_interval_;
+            }
+
+            const ClientTimeouts& t = slot.timeouts;
+            slot.retiring = false;
+            {
+                // A callback scheduled by the accepted handler may already
+                // be expiring
+                std::lock_guard<util::Mutex> l(timers_lock_);
+                slot.retire_due = false;
+                slot.retire_at = 0;
+                slot.retired = 0;
+            }
+
+            if (t.first_byte > 0 || t.connect > 0 || t.idle > 0 || t.read > 0
+                || t.write > 0 || t.max_age > 0) {
+                const std::int64_t now = now_ms();
+                slot.accepted = now;
+                slot.received.store(false, std::memory_order_relaxed);
+                slot.last_active.store(now, std::memory_order_relaxed);
+                slot.message_start.store(0, std::memory_order_relaxed);
+                slot.write_progress.store(0, std::memory_order_relaxed);
+
+                std::lock_guard<util::Mutex> l(timers_lock_);
+                if (t.max_age > 0) {
+                    slot.retire_at = now + max_age(t);
+                }
+
+                slot.deadline_timer = schedule(next_deadline(slot, now),
+                                               TimerKey{uuid, kNoRecord});
+            }
+
+            // Sampled from the next batch onwards
+            if (options_.tcp_info_interval > 0) {
+                std::lock_guard<util::Mutex> l(timers_lock_);
+                slot.live_index = static_cast<int>(live_.size());
+                live_.push_back(uuid);
+            }
+
+            client->set_read_armed(read);
+            slot.state.fetch_or(kArmed, std::memory_order_acq_rel);
+            if (!epoll_.add(client, sfd, flags)) {
+                return terminate(client), nullptr;
+            }
+
+            return client;
         }
 
-        template <typename q_t = PacketSinkType>
-        typename std::enable_if<
-            !std::is_base_of_v<enable_client_error<PacketSinkType, ClientType>,
-                               q_t>,
-            void>::type
-        have_client_error(ClientType*)
+        //! Claims a client for this worker, or, if another worker serves it,
+        //! leaves work to that worker.
+        //! @param slot
+        //!     Client slot
+        //! @param work
+        //!     Epoll event flags, kTimersDue and/or kTerminateDue
+        //! @return
+        //!     True if the client was claimed
+        static bool enter(ClientSlot& slot, std::uint32_t work)
         {
-            /* Not implemented in packet sink */
+            std::uint32_t state = slot.state.load(std::memory_order_acquire);
+            std::uint32_t next;
+            do {
+                next = state & kBusy ? state | work : state | kBusy;
+                // An event ends the one-shot registration
+                if (work & kEventMask) {
+                    next &= ~kArmed;
+                }
+            } while (!slot.state.compare_exchange_weak(
+                state, next, std::memory_order_acq_rel));
+
+            return !(state & kBusy);
         }
 
-        //! @param client
-        //!     Triggered client
-        template <typename q_t = PacketSinkType>
-        typename std::enable_if<
-            std::is_base_of_v<enable_client_error<PacketSinkType, ClientType>,
-                              q_t>,
-            void>::type
-        have_client_error(ClientType* client)
+        //! Releases a client, unless work was left meanwhile.
+        //! @param slot
+        //!     Client slot
+        //! @param flags[out]
+        //!     Epoll event flags left
+        //! @param timers_due[out]
+        //!     Whether callbacks expired meanwhile
+        //! @param terminate_due[out]
+        //!     Whether the client was terminated meanwhile
+        //! @return
+        //!     True if work was left, the client remaining claimed
+        static bool leave(ClientSlot& slot,
+                          int* flags,
+                          bool* timers_due,
+                          bool* terminate_due)
         {
-            const int uuid
-                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
-
-            ClientSession<ClientType> session(client, uuid);
-            packet_sink_->client_error(session);
+            constexpr std::uint32_t kWork
+                = kEventMask | kTimersDue | kTerminateDue;
+
+            std::uint32_t state = slot.state.load(std::memory_order_acquire);
+            std::uint32_t next;
+            do {
+                next = state & ~kWork;
+                if (next == state) {
+                    next &= ~kBusy;
+                }
+            } while (!slot.state.compare_exchange_weak(
+                state, next, std::memory_order_acq_rel));
+
+            *flags = static_cast<int>(state & kEventMask);
+            *timers_due = (state & kTimersDue) != 0;
+            *terminate_due = (state & kTerminateDue) != 0;
+            return (state & kWork) != 0;
         }
 
-        template <typename q_t = PacketSinkType>
-        typename std::enable_if<
-            !std::is_base_of_v<
-                enable_client_oob_received<PacketSinkType, ClientType>,
-                q_t>,
-            void>::type
-        have_client_oob_received(ClientType*, char)
+        //! Rearms client.
+        //! @param client
+        //!     Client to rearm
+        //! @param read
+        //!     Whether to arm read events, write events being armed while
+        //!     writes are queued
+        void arm(ClientType* client, bool read);
+
+        //! @return
+        //!     Current monotonic time (ms), as of this worker's last
+        //!     epoll_wait() return
+        static std::int64_t now_ms()
         {
-            /* Not implemented in packet sink */
+            return util::CoarseClock::now_ms();
         }
 
+        //! Records activity on a client, pushing back its idle timeout.
         //! @param client
-        //!     Triggered client
-        //! @param oobdata
-        //!     Out-of-band byte
-        template <typename q_t = PacketSinkType>
-        typename std::enable_if<
-            std::is_base_of_v<
-                enable_client_oob_received<PacketSinkType, ClientType>,
-                q_t>,
-            void>::type
-        have_client_oob_received(ClientType* client, char oobdata)
+        //!     Active client
+        void touch(ClientType* client)
         {
-            const int uuid
-                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+            ClientSlot& slot = slot_of(client);
+            if (slot.timeouts.idle > 0) {
+                slot.last_active.store(now_ms(), std::memory_order_relaxed);
+            }
+        }
 
-            ClientSession<ClientType> session(client, uuid);
+        //! Records the progress of the message being received and of queued
+        //! output, once a client has been served.
+        //! @param client
+        //!     Served client
+        //! @param delivered
+        //!     Whether a message was handed to the client's handlers
+        //! @param flushed
+        //!     Whether queued output was sent
+        void track(ClientType* client, bool delivered, bool flushed)
+        {
+            ClientSlot& slot = slot_of(client);
+
+            if (slot.timeouts.read > 0) {
+                const bool partial = client->reading_into()
+                                     || client->buffered_size() > 0;
+                std::int64_t start = 0;
+                if (partial) {
+                    start = slot.message_start.load(std::memory_order_relaxed);
+                    if (start == 0 || delivered) {
+                        start = now_ms();
+                    }
+                }
+
+                slot.message_start.store(start, std::memory_order_relaxed);
+            }
+
+            if (slot.timeouts.write > 0) {
+                std::int64_t progress = 0;
+                if (client->pending_output_size() > 0) {
+                    progress
+                        = slot.write_progress.load(std::memory_order_relaxed);
+                    if (progress == 0 || flushed) {
+                        progress = now_ms();
+                    }
+                }
+
+                slot.write_progress.store(progress, std::memory_order_relaxed);
+            }
+        }
+
+        //! @param slot
+        //!     Client slot
+        //! @param now
+        //!     Current time (ms)
+        //! @return
+        //!     Time the client's deadlines are next checked at (ms): the
+        //!     earliest running deadline, or the earliest a deadline not yet
+        //!     running could pass. Zero if a deadline has passed.
+        static std::int64_t next_deadline(const ClientSlot& slot,
+                                          std::int64_t now)
+        {
+            const ClientTimeouts& t = slot.timeouts;
+            std::int64_t next = -1;
+
+            const auto consider = [&](int interval, std::int64_t since) {
+                if (interval > 0) {
+                    const std::int64_t deadline
+                        = (since != 0 ? since : now) + interval;
+                    if (next == -1 || deadline < next) {
+                        next = deadline;
+                    }
+                }
+            };
+
+            if (!slot.received.load(std::memory_order_relaxed)) {
+                consider(t.first_byte, slot.accepted);
+            }
+
+            if (slot.connecting.load(std::memory_order_relaxed)) {
+                consider(t.connect, slot.accepted);
+            }
+
+            consider(t.idle, slot.last_active.load(std::memory_order_relaxed));
+            consider(t.read,
+                     slot.message_start.load(std::memory_order_relaxed));
+            consider(t.write,
+                     slot.write_progress.load(std::memory_order_relaxed));
+
+            if (slot.retired != 0) {
+                consider(t.max_age_grace, slot.retired);
+            }
+
+            if (slot.retire_at != 0 && (next == -1 || slot.retire_at < next)) {
+                next = slot.retire_at;
+            }
+
+            return next != -1 && next <= now ? 0 : next;
+        }
+
+        //! @param timeouts
+        //!     Client deadlines, with a maximum age
+        //! @return
+        //!     Maximum age of a new client (ms), less a random jitter
+        static std::int64_t max_age(const ClientTimeouts& timeouts)
+        {
+            int jitter = timeouts.max_age_jitter;
+            if (jitter >= timeouts.max_age) {
+                jitter = timeouts.max_age - 1;
+            }
+
+            if (jitter <= 0) {
+                return timeouts.max_age;
+            }
+
+            thread_local std::minstd_rand engine(std::random_device{}());
+            std::uniform_int_distribution<int> distribution(0, jitter);
+            return timeouts.max_age - distribution(engine);
+        }
+
+        //! Retires a client that has reached its maximum age, once no
+        //! request is in progress, by shutting down its write side.
+        //! Must be called by the worker serving the client.
+        //! @param client
+        //!     Served client
+        //! @return
+        //!     True if the client was retired
+        bool retire_if_idle(ClientType* client)
+        {
+            ClientSlot& slot = slot_of(client);
+            if (!slot.retiring || client->reading_into()
+                || client->buffered_size() > 0
+                || client->pending_output_size() > 0) {
+                return false;
+            }
+
+            slot.retiring = false;
+            const int sfd
+                = static_cast<util::StackNode<ClientType>*>(client)->sfd;
+            ::shutdown(sfd, SHUT_WR);
+            retired_count_.fetch_add(1, std::memory_order_relaxed);
+
+            // Grace period runs from now
+            if (slot.timeouts.max_age_grace > 0) {
+                const int uuid
+                    = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+                const std::int64_t now = now_ms();
+
+                std::lock_guard<util::Mutex> l(timers_lock_);
+                slot.retired = now;
+                if (slot.deadline_timer != Wheel::kNullHandle) {
+                    timers_.cancel(slot.deadline_timer);
+                }
+
+                slot.deadline_timer = schedule(next_deadline(slot, now),
+                                               TimerKey{uuid, kNoRecord});
+            }
+
+            return true;
+        }
+
+        //! Schedules a client deadline, setting the epoll timer to it if it
+        //! is the earliest. Must be called with timers_lock_ held.
+        //! @param deadline
+        //!     Expiry time (ms)
+        //! @param key
+        //!     Client deadline
+        //! @return
+        //!     Deadline handle
+        typename Wheel::Handle schedule(std::int64_t deadline, TimerKey key)
+        {
+            const auto handle = timers_.schedule(deadline, key);
+            if (timer_deadline_ == -1 || deadline < timer_deadline_) {
+                timer_deadline_ = deadline;
+                const std::int64_t delay = deadline - now_ms();
+                epoll_.set_timer(delay > 0 ? delay : 0);
+            }
+
+            return handle;
+        }
+
+        //! Cancels a closing client's deadlines and callbacks. Once done,
+        //! timer expiry no longer touches the client's socket.
+        //! @param client
+        //!     Closing client
+        void cancel_timers(ClientType* client)
+        {
+            ClientSlot& slot = slot_of(client);
+
+            std::lock_guard<util::Mutex> l(timers_lock_);
+            if (slot.deadline_timer != Wheel::kNullHandle) {
+                timers_.cancel(slot.deadline_timer);
+                slot.deadline_timer = Wheel::kNullHandle;
+            }
+
+            slot.timed_out = false;
+            slot.retire_due = false;
+
+            while (slot.records != kNoRecord) {
+                const std::uint32_t index = slot.records;
+                TimerRecord& record = timer_records_[index];
+                if (record.handle != Wheel::kNullHandle) {
+                    timers_.cancel(record.handle);
+                }
+
+                // A callback running on a worker, such as when terminated
+                // from another thread, is destroyed by that worker
+                if (record.running) {
+                    unlink_record(index);
+                    record.cancelled = true;
+                    continue;
+                }
+
+                release_record(index);
+            }
+
+            slot.due_head = slot.due_tail = kNoRecord;
+            slot.on_connected.reset();
+            slot.connecting.store(false, std::memory_order_relaxed);
+
+            // Swapped out of the live clients, the last taking its place
+            if (slot.live_index != -1) {
+                const int last = live_.back();
+                live_[slot.live_index] = last;
+                slots_[last].live_index = slot.live_index;
+                live_.pop_back();
+                slot.live_index = -1;
+            }
+
+            slot.tcp = TcpSample();
+        }
+
+        //! Takes the next batch of clients to sample and schedules the one
+        //! after, spreading batches so that each client is sampled once per
+        //! interval. Must be called with timers_lock_ held.
+        //! @param now
+        //!     Current time (ms)
+        //! @param batch[out]
+        //!     Uuids of the clients to sample
+        void take_sample_batch(std::int64_t now, std::vector<int>* batch)
+        {
+            const std::size_t size = live_.size();
+            const std::size_t limit
+                = options_.tcp_info_batch > 0 ? options_.tcp_info_batch : 1;
+            const std::size_t batches = (size + limit - 1) / limit;
+
+            for (std::size_t i = 0; i != size && i != limit; ++i) {
+                if (live_cursor_ >= size) {
+                    live_cursor_ = 0;
+                }
+
+                batch->push_back(live_[live_cursor_++]);
+            }
+
+            std::int64_t period = options_.tcp_info_interval;
+            if (batches > 1) {
+                period /= static_cast<std::int64_t>(batches);
+            }
+
+            timers_.schedule(now + (period > 0 ? period : 1),
+                             TimerKey{kSampler, kNoRecord});
+        }
+
+        //! Reads a client's TCP_INFO, recording it in the TCP metrics.
+        //! Must be called by the worker serving the client.
+        //! @param client
+        //!     Served client
+        void sample_tcp_info(ClientType* client)
+        {
+            const int sfd
+                = static_cast<util::StackNode<ClientType>*>(client)->sfd;
+
+            struct tcp_info info = {};
+            socklen_t size = sizeof(info);
+            if (::getsockopt(sfd, IPPROTO_TCP, TCP_INFO, &info, &size) != 0) {
+                return;
+            }
+
+            TcpSample& sample = slot_of(client).tcp;
+            const std::uint32_t retransmits
+                = info.tcpi_total_retrans - sample.retransmits;
+
+            sample.rtt = info.tcpi_rtt;
+            sample.rtt_var = info.tcpi_rttvar;
+            sample.cwnd = info.tcpi_snd_cwnd;
+            sample.retransmits = info.tcpi_total_retrans;
+            sample.unacked = info.tcpi_unacked * info.tcpi_snd_mss;
+            sample.sampled_at = now_ms();
+
+            tcp_rtt_.record(sample.rtt);
+            tcp_cwnd_.record(sample.cwnd);
+            tcp_retransmits_.record(retransmits);
+            tcp_unacked_.record(sample.unacked);
+            tcp_sample_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        //! Unlinks a callback record from its client and frees it. Must be
+        //! called with timers_lock_ held.
+        //! @param index
+        //!     Record index
+        void release_record(std::uint32_t index)
+        {
+            unlink_record(index);
+            free_record(index);
+        }
+
+        //! Unlinks a callback record from its client, leaving it to no
+        //! client. Must be called with timers_lock_ held.
+        //! @param index
+        //!     Record index
+        void unlink_record(std::uint32_t index)
+        {
+            TimerRecord& record = timer_records_[index];
+            ClientSlot& slot = slots_[record.uuid];
+
+            if (record.prev != kNoRecord) {
+                timer_records_[record.prev].next = record.next;
+            } else {
+                slot.records = record.next;
+            }
+
+            if (record.next != kNoRecord) {
+                timer_records_[record.next].prev = record.prev;
+            }
+
+            record.uuid = -1;
+            record.prev = record.next = kNoRecord;
+        }
+
+        //! Frees an unlinked callback record. Must be called with
+        //! timers_lock_ held.
+        //! @param index
+        //!     Record index
+        void free_record(std::uint32_t index)
+        {
+            TimerRecord& record = timer_records_[index];
+
+            record.callback.reset();
+            record.handle = Wheel::kNullHandle;
+            record.cancelled = false;
+            record.running = false;
+            ++record.sequence;
+
+            record.next = free_record_;
+            free_record_ = index;
+        }
+
+        //! Closes a client this thread has claimed or is dispatching.
+        //! @param client
+        //!     Client to close
+        //! @param release
+        //!     Whether to release the claim as the client is recycled, for a
+        //!     client claimed outside serve()
+        void close_client(ClientType* client, bool release);
+
+        //! Destroys client and returns it to unused queue.
+        //! @param client
+        //!     Terminated client
+        //! @param release
+        //!     Whether to release the claim on the client too
+        void recycle(ClientType* client, bool release = false);
+
+        //! @param client
+        //!     Client to test
+        //! @return
+        //!     True if the client's socket has been closed
+        static bool is_closed(ClientType* client)
+        {
+            return static_cast<util::StackNode<ClientType>*>(client)->sfd == 0;
+        }
+
+        //! Closes socket and returns client to unused queue.
+        //! @param client
+        //!     To be terminated
+        void terminate_on_close(ClientType* client);
+
+        //! Closes socket and returns client to unused queue.
+        //! @param client
+        //!     To be terminated
+        void terminate_on_error(ClientType* client);
+
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            !std::is_base_of_v<
+                enable_client_accepted<PacketSinkType, ClientType>,
+                q_t>,
+            void>::type
+        have_client_accepted(ClientType&)
+        {
+            /* Not implemented in packet sink */
+        }
+
+        //! @param client
+        //!     Triggered client
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            std::is_base_of_v<
+                enable_client_accepted<PacketSinkType, ClientType>,
+                q_t>,
+            void>::type
+        have_client_accepted(ClientType* client)
+        {
+            const int uuid
+                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+
+            ClientSession<ClientType> session(client, uuid);
+            packet_sink_->client_accepted(session);
+        }
+
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            !std::is_base_of_v<enable_client_closed<PacketSinkType, ClientType>,
+                               q_t>,
+            void>::type
+        have_client_closed(ClientType*)
+        {
+            /* Not implemented in packet sink */
+        }
+
+        //! @param client
+        //!     Triggered client
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            std::is_base_of_v<enable_client_closed<PacketSinkType, ClientType>,
+                              q_t>,
+            void>::type
+        have_client_closed(ClientType* client)
+        {
+            const int uuid
+                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+
+            ClientSession<ClientType> session(client, uuid);
+            packet_sink_->client_closed(session);
+        }
+
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            !std::is_base_of_v<enable_client_error<PacketSinkType, ClientType>,
+                               q_t>,
+            void>::type
+        have_client_error(ClientType*)
+        {
+            /* Not implemented in packet sink */
+        }
+
+        //! @param client
+        //!     Triggered client
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            std::is_base_of_v<enable_client_error<PacketSinkType, ClientType>,
+                              q_t>,
+            void>::type
+        have_client_error(ClientType* client)
+        {
+            const int uuid
+                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+
+            ClientSession<ClientType> session(client, uuid);
+            packet_sink_->client_error(session);
+        }
+
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            !std::is_base_of_v<
+                enable_client_oob_received<PacketSinkType, ClientType>,
+                q_t>,
+            void>::type
+        have_client_oob_received(ClientType*, char)
+        {
+            /* Not implemented in packet sink */
+        }
+
+        //! @param client
+        //!     Triggered client
+        //! @param oobdata
+        //!     Out-of-band byte
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            std::is_base_of_v<
+                enable_client_oob_received<PacketSinkType, ClientType>,
+                q_t>,
+            void>::type
+        have_client_oob_received(ClientType* client, char oobdata)
+        {
+            const int uuid
+                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+
+            ClientSession<ClientType> session(client, uuid);
             packet_sink_->client_oob_received(session, oobdata);
         }
 
-        template <typename q_t = PacketSinkType>
-        typename std::enable_if<
-            !std::is_base_of_v<
-                enable_client_data_received<PacketSinkType, ClientType>,
-                q_t>,
-            void>::type
-        have_client_data_received(ClientType*, const char*, const int)
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            !std::is_base_of_v<
+                enable_client_data_received<PacketSinkType, ClientType>,
+                q_t>,
+            void>::type
+        have_client_data_received(ClientType*, const char*, const int)
+        {
+            /* Not implemented in packet sink */
+        }
+
+        //! @param client
+        //!     Triggered client
+        //! @param data
+        //!     Received message data
+        //! @param size
+        //!     Received message data size
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            std::is_base_of_v<
+                enable_client_data_received<PacketSinkType, ClientType>,
+                q_t>,
+            void>::type
+        have_client_data_received(ClientType* client,
+                                  const char* data,
+                                  const int size)
+        {
+            const int uuid
+                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+
+            ClientSession<ClientType> session(client, uuid);
+            packet_sink_->client_data_received(session, data, size);
+        }
+
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            !std::is_base_of_v<
+                enable_client_read_completed<PacketSinkType, ClientType>,
+                q_t>,
+            void>::type
+        have_client_read_completed(ClientType*, char*, const int)
+        {
+            /* Not implemented in packet sink */
+        }
+
+        //! @param client
+        //!     Triggered client
+        //! @param buff
+        //!     Filled read-into buffer
+        //! @param size
+        //!     Read-into buffer size
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            std::is_base_of_v<
+                enable_client_read_completed<PacketSinkType, ClientType>,
+                q_t>,
+            void>::type
+        have_client_read_completed(ClientType* client,
+                                   char* buff,
+                                   const int size)
+        {
+            const int uuid
+                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+
+            ClientSession<ClientType> session(client, uuid);
+            packet_sink_->client_read_completed(session, buff, size);
+        }
+
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            !std::is_base_of_v<
+                enable_client_zerocopy_received<PacketSinkType, ClientType>,
+                q_t>,
+            void>::type
+        have_client_zerocopy_received(ClientType* client,
+                                      const char*,
+                                      const int)
+        {
+            /* Not implemented in packet sink */
+            client->release_zerocopy();
+        }
+
+        //! @param client
+        //!     Triggered client
+        //! @param data
+        //!     Mapped pages, valid until released through the session
+        //! @param size
+        //!     Number of bytes mapped
+        template <typename q_t = PacketSinkType>
+        typename std::enable_if<
+            std::is_base_of_v<
+                enable_client_zerocopy_received<PacketSinkType, ClientType>,
+                q_t>,
+            void>::type
+        have_client_zerocopy_received(ClientType* client,
+                                      const char* data,
+                                      const int size)
+        {
+            const int uuid
+                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+
+            ClientSession<ClientType> session(client, uuid);
+            packet_sink_->client_zerocopy_received(session, data, size);
+        }
+
+        //! Hands received data to the client's event handler, or to the
+        //! packet sink.
+        //! @param client
+        //!     Triggered client
+        //! @param data
+        //!     Message data
+        //! @param size
+        //!     Message data size
+        void notify_data_received(ClientType* client,
+                                  const char* data,
+                                  const int size)
+        {
+            ClientEventHandler<ClientType>* handler = slot_of(client).handler;
+            if (handler == nullptr) {
+                have_client_data_received(client, data, size);
+                return;
+            }
+
+            const int uuid
+                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+
+            ClientSession<ClientType> session(client, uuid);
+            handler->client_data_received(session, data, size);
+        }
+
+        //! Tells the client's event handler, once, or the packet sink, that
+        //! the client closes.
+        //! @param client
+        //!     Closing client
+        //! @param sink
+        //!     Whether the packet sink is told, if the client has no handler
+        void notify_closed(ClientType* client, bool sink = true)
+        {
+            ClientSlot& slot = slot_of(client);
+            if (slot.handler == nullptr) {
+                if (sink) {
+                    have_client_closed(client);
+                }
+
+                return;
+            }
+
+            if (slot.handler_closed) {
+                return;
+            }
+
+            slot.handler_closed = true;
+            const int uuid
+                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+
+            ClientSession<ClientType> session(client, uuid);
+            slot.handler->client_closed(session);
+        }
+
+        //! Hands read data to the packet sink, filling any posted read-into
+        //! buffer first.
+        //! @param client
+        //!     Triggered client
+        //! @param data
+        //!     Data read
+        //! @param size
+        //!     Size of the data read
+        //! @return
+        //!     False on a framing protocol violation, true otherwise
+        bool deliver(ClientType* client, const char* data, int size);
+
+        //! Completes an outbound connect.
+        //! @param client
+        //!     Triggered client
+        //! @param flags
+        //!     Epoll event flags
+        void connect_triggered(ClientType* client, int flags);
+
+        //! Starts a relay's outbound connect.
+        //! @param relay
+        //!     Relay, its proxied client being served by the calling thread
+        //! @return
+        //!     False if the connect could not be started
+        bool start_relay(Relay* relay)
+        {
+            relay->refs.fetch_add(1, std::memory_order_relaxed);
+            RelayRef ref(relay);
+
+            // The callback may run on another worker before this returns
+            return connect_client(
+                       relay->address,
+                       [this, ref = std::move(ref)](
+                           ClientSession<ClientType>& session,
+                           int error) mutable {
+                           relay_connected(ref, session.uuid(), error);
+                       },
+                       relay->timeouts)
+                   != nullptr;
+        }
+
+        //! Completes a relay's outbound connect, joining the connection to
+        //! the relay.
+        //! @param ref
+        //!     Reference held by the connect, taken over by the connection
+        //!     once joined
+        //! @param uuid
+        //!     Outbound connection's uuid
+        //! @param error
+        //!     Connect error, zero if established
+        void relay_connected(RelayRef& ref, int uuid, int error)
+        {
+            Relay* relay = ref.get();
+            ClientType* client = &mem_pool_.ptr_to_mem_slab[uuid];
+
+            bool joined = false;
+            if (error == 0) {
+                // The proxied client may have closed meanwhile
+                std::lock_guard<util::Mutex> l(relay->lock);
+                if (!relay->failed.load(std::memory_order_acquire)) {
+                    relay->clients[1] = client;
+                    relay->uuids[1] = uuid;
+                    relay->sfds[1]
+                        = static_cast<util::StackNode<ClientType>*>(client)
+                              ->sfd;
+
+                    ClientSlot& slot = slot_of(client);
+                    slot.relay = ref.release();
+                    slot.relay_side = 1;
+                    joined = true;
+                }
+            }
+
+            if (!joined) {
+                fail(relay);
+                kick(relay, 0);
+
+                // Closed without further callbacks, like a failed connect
+                if (error == 0) {
+                    terminate(client);
+                }
+
+                return;
+            }
+
+            // Bytes held back on the proxied client flow from here on
+            relay->connecting.store(false, std::memory_order_release);
+            pump(relay, 0, 1);
+        }
+
+        //! Ends a relay, counting it as failed the first time.
+        //! @param relay
+        //!     Relay
+        void fail(Relay* relay)
+        {
+            if (!relay->failed.exchange(true, std::memory_order_acq_rel)) {
+                relay_failure_count_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        //! Has a relayed client act on a change of its relay. The client is
+        //! claimed for this worker and served once the current client is
+        //! done, or left to the worker serving it. Outside a worker, such as
+        //! when terminated from another thread, it is woken through the
+        //! timer instead.
+        //! @param relay
+        //!     Relay
+        //! @param side
+        //!     Client's side
+        void kick(Relay* relay, int side)
+        {
+            // A closed client is out of the relay before its slot is reused
+            std::lock_guard<util::Mutex> l(relay->lock);
+            ClientType* client = relay->clients[side];
+            if (client == nullptr) {
+                return;
+            }
+
+            if (worker_index_ != -1) {
+                if (enter(slot_of(client), kRelayEvents)) {
+                    relay_peers_.push_back(client);
+                }
+
+                return;
+            }
+
+            ClientSlot& slot = slot_of(client);
+            std::lock_guard<util::Mutex> t(timers_lock_);
+            if (slot.relay_timer == Wheel::kNullHandle) {
+                slot.relay_timer = schedule(
+                    now_ms(), TimerKey{relay->uuids[side], kRelayWakeup});
+            }
+        }
+
+        //! Takes a closing client out of its relay, which fails unless both
+        //! of the client's directions are done, and has the other client act
+        //! on it.
+        //! @param client
+        //!     Closing client
+        //! @return
+        //!     True if the relay keeps the client's socket, shut down, for
+        //!     the other client's passes, the caller then leaving it open
+        bool release_relay(ClientType* client)
+        {
+            ClientSlot& slot = slot_of(client);
+            Relay* relay = std::exchange(slot.relay, nullptr);
+            if (relay == nullptr) {
+                return false;
+            }
+
+            const int side = slot.relay_side;
+            if (!relay->directions[side].eof.load(std::memory_order_acquire)
+                || !relay->directions[1 - side].done.load(
+                    std::memory_order_acquire)) {
+                fail(relay);
+            }
+
+            // Passes check for failure before each call on the sockets, but
+            // one of the other client's past the check may still be about
+            // to use this client's. Its descriptor then stays open, and
+            // cannot be reused, until the relay is deleted.
+            bool kept = false;
+            {
+                std::lock_guard<util::Mutex> l(relay->lock);
+                relay->clients[side] = nullptr;
+                if (relay->failed.load(std::memory_order_acquire)
+                    && relay->clients[1 - side] != nullptr) {
+                    relay->kept[side] = true;
+                    kept = true;
+                }
+            }
+
+            if (kept) {
+                ::shutdown(relay->sfds[side], SHUT_RDWR);
+            }
+
+            // Out of the relay, the client is no longer woken for it
+            {
+                std::lock_guard<util::Mutex> l(timers_lock_);
+                if (slot.relay_timer != Wheel::kNullHandle) {
+                    timers_.cancel(slot.relay_timer);
+                    slot.relay_timer = Wheel::kNullHandle;
+                }
+            }
+
+            kick(relay, 1 - side);
+            unref(relay);
+            return kept;
+        }
+
+        //! Runs passes over one direction of a relay, unless another thread
+        //! runs them, which then runs one more.
+        //! @param relay
+        //!     Relay
+        //! @param from
+        //!     Side of the direction's source client
+        //! @param self
+        //!     Side of the client the calling worker serves
+        void pump(Relay* relay, int from, int self)
+        {
+            RelayDirection& direction = relay->directions[from];
+            if (direction.passes.fetch_add(1, std::memory_order_acq_rel)
+                != 0) {
+                return;
+            }
+
+            std::uint32_t passes = 1;
+            do {
+                relay_pass(relay, from, self);
+                passes = direction.passes.fetch_sub(passes,
+                                                    std::memory_order_acq_rel)
+                         - passes;
+            } while (passes != 0);
+        }
+
+        //! Splices bytes from the source into the pipe, and from the pipe
+        //! into the sink, until either would block.
+        //! @param relay
+        //!     Relay
+        //! @param from
+        //!     Side of the direction's source client
+        //! @param self
+        //!     Side of the client the calling worker serves
+        void relay_pass(Relay* relay, int from, int self)
+        {
+            RelayDirection& direction = relay->directions[from];
+            const int to = 1 - from;
+
+            const bool was_blocked
+                = direction.blocked.load(std::memory_order_relaxed);
+            const bool was_eof = direction.eof.load(std::memory_order_relaxed);
+            const bool was_done
+                = direction.done.load(std::memory_order_relaxed);
+            const bool was_failed
+                = relay->failed.load(std::memory_order_acquire);
+
+            bool blocked = false;
+            std::uint64_t moved = 0;
+            while (!relay->failed.load(std::memory_order_acquire)
+                   && !direction.done.load(std::memory_order_relaxed)) {
+                // The outbound connection takes and gives bytes once
+                // established, and a client takes them once its own queued
+                // output is sent
+                if (relay->connecting.load(std::memory_order_acquire)) {
+                    blocked = to == 1;
+                    break;
+                }
+
+                if (relay->queued[to].load(std::memory_order_acquire)) {
+                    blocked = true;
+                    break;
+                }
+
+                if (direction.buffered > 0) {
+                    const int n = util::endpoint_splice(direction.pipe[0],
+                                                        relay->sfds[to],
+                                                        direction.buffered);
+                    if (n > 0) {
+                        direction.buffered -= n;
+                        moved += n;
+                        continue;
+                    }
+
+                    if (n == -1 && errno == EINTR) {
+                        continue;
+                    }
+
+                    if (n == -1 && errno == EAGAIN) {
+                        blocked = true;
+                    } else {
+                        fail(relay);
+                    }
+
+                    break;
+                }
+
+                // Drained, the end of input is passed on
+                if (direction.eof.load(std::memory_order_relaxed)) {
+                    ::shutdown(relay->sfds[to], SHUT_WR);
+                    direction.done.store(true, std::memory_order_release);
+                    break;
+                }
+
+                // The pipe is empty, so that only the source can block
+                const int n = util::endpoint_splice(relay->sfds[from],
+                                                    direction.pipe[1],
+                                                    relay->pipe_size);
+                if (n > 0) {
+                    direction.buffered = n;
+                    continue;
+                }
+
+                if (n == 0) {
+                    direction.eof.store(true, std::memory_order_release);
+                    continue;
+                }
+
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                if (errno != EAGAIN) {
+                    fail(relay);
+                }
+
+                break;
+            }
+
+            direction.blocked.store(blocked, std::memory_order_release);
+
+            // Both clients are active while bytes flow either way
+            if (moved > 0) {
+                relayed_bytes_.fetch_add(moved, std::memory_order_relaxed);
+                for (const int uuid: relay->uuids) {
+                    ClientSlot& slot = slots_[uuid];
+                    if (slot.timeouts.idle > 0) {
+                        slot.last_active.store(now_ms(),
+                                               std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // The served client acts on the change as it is rearmed, the
+            // other one is woken
+            if (blocked != was_blocked
+                || direction.eof.load(std::memory_order_relaxed) != was_eof
+                || direction.done.load(std::memory_order_relaxed) != was_done
+                || relay->failed.load(std::memory_order_acquire)
+                       != was_failed) {
+                kick(relay, 1 - self);
+            }
+        }
+
+        //! @param slot
+        //!     Slot of a relayed client
+        //! @return
+        //!     Epoll events the client's relay waits on, zero if none
+        static int relay_events(const ClientSlot& slot)
+        {
+            const Relay* relay = slot.relay;
+
+            // A failed relay closes the client as soon as it is served
+            if (relay->failed.load(std::memory_order_acquire)) {
+                return EPOLLIN | EPOLLRDHUP | EPOLLOUT;
+            }
+
+            const RelayDirection& out = relay->directions[slot.relay_side];
+            const RelayDirection& in = relay->directions[1 - slot.relay_side];
+
+            int events = 0;
+            if (!out.eof.load(std::memory_order_acquire)
+                && !out.blocked.load(std::memory_order_acquire)) {
+                events |= EPOLLIN | EPOLLRDHUP;
+            }
+
+            if (in.blocked.load(std::memory_order_acquire)
+                || relay->queued[slot.relay_side].load(
+                    std::memory_order_acquire)) {
+                events |= EPOLLOUT;
+            }
+
+            return events;
+        }
+
+        //! Moves relayed bytes on a relayed client's events.
+        //! @param client
+        //!     Triggered client
+        //! @param flags
+        //!     Epoll event flags
+        void relay_triggered(ClientType* client, int flags);
+
+        //! EPOLLPRI event handler
+        inline void pri_read_ready_triggered(ClientType*);
+
+        //! EPOLLIN event handler
+        inline void read_ready_triggered(ClientType*);
+    };
+
+    /*! Reactivates client for next read.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::rearm(ClientType* client)
+    {
+        // Client is being dispatched on this thread, defer rearm until the
+        // dispatch completes so that no other worker can be triggered on the
+        // client while it is still being read
+        if (client == dispatched_client_) {
+            dispatched_client_rearmed_ = true;
+            return;
+        }
+
+        arm(client, true);
+    }
+
+    /*! Rearms client for read and/or queued write events.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::arm(ClientType* client,
+                                                     bool read)
+    {
+        const int sfd = static_cast<util::StackNode<ClientType>*>(client)->sfd;
+
+        // A relayed client is left disarmed while its relay waits on the
+        // other client, which claims it once the relay changes
+        ClientSlot& slot = slot_of(client);
+        if (slot.relay != nullptr) {
+            const int events = relay_events(slot);
+            if (events != 0) {
+                slot.state.fetch_or(kArmed, std::memory_order_acq_rel);
+                epoll_.rearm(client,
+                             sfd,
+                             EPOLLET | EPOLLHUP | EPOLLONESHOT | events);
+            }
+
+            return;
+        }
+
+        constexpr int kReadFlags = EPOLLIN | EPOLLRDHUP | EPOLLPRI;
+
+        const int pending = client->pending_output_size();
+
+        // Reads pause while too much output is queued, and resume once it
+        // has drained; the read interest is kept meanwhile
+        if (options_.output_high_watermark > 0) {
+            if (client->read_paused()) {
+                client->set_read_paused(pending
+                                        > options_.output_low_watermark);
+            } else {
+                client->set_read_paused(pending
+                                        > options_.output_high_watermark);
+            }
+        }
+
+        int flags = EPOLLET | EPOLLHUP | EPOLLONESHOT;
+        if (read && !client->read_paused()) {
+            flags |= kReadFlags;
+        }
+
+        if (pending > 0) {
+            flags |= EPOLLOUT;
+        }
+
+        FSERV_TRACE(rearm,
+                    kRearm,
+                    static_cast<util::StackNode<ClientType>*>(client)->uuid,
+                    pending);
+
+        client->set_read_armed(read);
+        slot.state.fetch_or(kArmed, std::memory_order_acq_rel);
+        epoll_.rearm(client, sfd, flags);
+    }
+
+    /*! Closes socket and pushes client to free stack.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::terminate(ClientType* client)
+    {
+        const int sfd = static_cast<util::StackNode<ClientType>*>(client)->sfd;
+
+        if (sfd == 0) {
+            return;
+        }
+
+        // Callbacks may run while the client is registered, and an event
+        // already received by another worker would then reach a reused slot.
+        // Shut the socket down instead, for the resulting hang-up event to
+        // close the client.
+        if (client == dispatched_client_ && dispatched_by_timer_) {
+            if (slot_of(client).relay != nullptr) {
+                fail(slot_of(client).relay);
+            }
+
+            ::shutdown(sfd, SHUT_RDWR);
+            dispatched_client_shut_down_ = true;
+            return;
+        }
+
+        // Another worker may be in one of the client's handlers, such as
+        // when terminated from another thread. The client is claimed before
+        // it is closed, or else the terminate is left to that worker,
+        // which closes the client once done.
+        if (client != dispatched_client_ && client != accepted_client_) {
+            if (enter(slot_of(client), kTerminateDue)) {
+                close_client(client, true);
+            }
+
+            return;
+        }
+
+        close_client(client, false);
+    }
+
+    /*! Closes socket and pushes client to free stack.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::close_client(
+        ClientType* client,
+        bool release)
+    {
+        const int sfd = static_cast<util::StackNode<ClientType>*>(client)->sfd;
+
+        // Closed by its worker before it could be claimed
+        if (sfd == 0) {
+            if (release) {
+                slot_of(client).state.store(0, std::memory_order_release);
+            }
+
+            return;
+        }
+
+        // Close socket descriptor
+        FSERV_TRACE(close,
+                    kClose,
+                    static_cast<util::StackNode<ClientType>*>(client)->uuid,
+                    0);
+        cancel_timers(client);
+        // Unregistered first, as a relay keeping the socket closes it with
+        // the other client
+        epoll_.remove(sfd);
+        if (!release_relay(client)) {
+            util::endpoint_close(sfd);
+        }
+
+        // Clear
+        static_cast<util::StackNode<ClientType>*>(client)->sfd = 0;
+
+        /* No callback, other than to the client's own event handler */
+        notify_closed(client, false);
+
+        // Push back to stack of ready clients
+        recycle(client, release);
+    }
+
+    /*! Closes socket and pushes client to free stack.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::terminate_on_close(
+        ClientType* client)
+    {
+        const int sfd = static_cast<util::StackNode<ClientType>*>(client)->sfd;
+
+        if (sfd == 0) {
+            return;
+        }
+
+        // Close socket descriptor
+        FSERV_TRACE(close,
+                    kClose,
+                    static_cast<util::StackNode<ClientType>*>(client)->uuid,
+                    0);
+        cancel_timers(client);
+        // Unregistered first, as a relay keeping the socket closes it with
+        // the other client
+        epoll_.remove(sfd);
+        if (!release_relay(client)) {
+            util::endpoint_close(sfd);
+        }
+
+        // Clear
+        static_cast<util::StackNode<ClientType>*>(client)->sfd = 0;
+
+        // Trigger callback
+        notify_closed(client);
+
+        // Push back to stack of ready clients
+        recycle(client);
+    }
+
+    /*! Closes socket and pushes client to free stack.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::terminate_on_error(
+        ClientType* client)
+    {
+        const int sfd = static_cast<util::StackNode<ClientType>*>(client)->sfd;
+
+        if (sfd == 0) {
+            return;
+        }
+
+        // Close socket descriptor
+        FSERV_TRACE(close,
+                    kClose,
+                    static_cast<util::StackNode<ClientType>*>(client)->uuid,
+                    0);
+        cancel_timers(client);
+        // Unregistered first, as a relay keeping the socket closes it with
+        // the other client
+        epoll_.remove(sfd);
+        if (!release_relay(client)) {
+            util::endpoint_close(sfd);
+        }
+
+        // Clear
+        static_cast<util::StackNode<ClientType>*>(client)->sfd = 0;
+
+        // Trigger callback
+        if (slot_of(client).handler != nullptr) {
+            notify_closed(client);
+        } else {
+            have_client_error(client);
+        }
+
+        // Push back to stack of ready clients
+        recycle(client);
+    }
+
+    /*! Called on triggered event.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::trigger(ClientType* client,
+                                                         int flags)
+    {
+        // Another worker serves the client, and handles the event once done
+        if (!enter(slot_of(client), static_cast<std::uint32_t>(flags))) {
+            return;
+        }
+
+        serve(client, flags, false);
+    }
+
+    /*! Serves a client until no work is left.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::serve(ClientType* client,
+                                                       int flags,
+                                                       bool timers_due)
+    {
+        while (true) {
+            ClientSlot& slot = slot_of(client);
+
+            // The cached time may be stale after serving a previous client
+            WorkerActivity* const worker = worker_;
+            std::int64_t since = 0;
+            if (worker != nullptr) {
+                util::CoarseClock::refresh();
+                since = now_ms();
+                worker->uuid.store(
+                    static_cast<util::StackNode<ClientType>*>(client)->uuid,
+                    std::memory_order_relaxed);
+                worker->since.store(since, std::memory_order_release);
+            }
+
+            bool terminate_due = false;
+            do {
+                // Terminated while served, from another thread
+                if (terminate_due) {
+                    close_client(client, false);
+                    continue;
+                }
+
+                if (flags != 0) {
+                    dispatch_events(client, flags);
+                }
+
+                if (timers_due) {
+                    run_timers(client);
+                }
+            } while (leave(slot, &flags, &timers_due, &terminate_due));
+
+            if (worker != nullptr) {
+                worker->since.store(0, std::memory_order_release);
+                if (worker->stalled.load(std::memory_order_acquire) == since) {
+                    util::CoarseClock::refresh();
+                    stall_durations_.record(now_ms() - since);
+                }
+            }
+
+            // Relayed clients claimed meanwhile are served next
+            if (relay_peers_.empty()) {
+                break;
+            }
+
+            client = relay_peers_.back();
+            relay_peers_.pop_back();
+            flags = kRelayEvents;
+            timers_due = false;
+        }
+    }
+
+    /*! Checks workers for stalls until stopped.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::watch(int worker_count)
+    {
+        const int threshold = options_.stall_threshold;
+        const auto period
+            = std::chrono::milliseconds(threshold > 1 ? threshold / 2 : 1);
+
+        std::unique_lock<std::mutex> l(watchdog_lock_);
+        while (!watchdog_wake_.wait_for(l, period, [this] {
+            return watchdog_stop_;
+        })) {
+            const std::int64_t now = now_ms();
+            for (int i = 0; i != worker_count; ++i) {
+                WorkerActivity& worker = workers_[i];
+                const std::int64_t since
+                    = worker.since.load(std::memory_order_acquire);
+                if (since == 0 || now - since < threshold
+                    || worker.stalled.load(std::memory_order_relaxed)
+                           == since) {
+                    continue;
+                }
+
+                // The worker may have moved on to another client meanwhile
+                const int uuid = worker.uuid.load(std::memory_order_relaxed);
+                if (worker.since.load(std::memory_order_acquire) != since) {
+                    continue;
+                }
+
+                worker.stalled.store(since, std::memory_order_release);
+                stall_count_.fetch_add(1, std::memory_order_relaxed);
+
+                StallReport report;
+                report.worker = i;
+                report.uuid = uuid;
+                report.duration = now - since;
+                if (options_.stall_signal != 0) {
+                    capture_backtrace(worker, &report.frames);
+                }
+
+                if (stall_handler_) {
+                    stall_handler_(report);
+                }
+            }
+        }
+    }
+
+    /*! Captures the backtrace of a worker.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::capture_backtrace(
+        WorkerActivity& worker,
+        std::vector<void*>* frames)
+    {
+        worker.frame_count.store(-1, std::memory_order_relaxed);
+        if (::pthread_kill(worker.thread, options_.stall_signal) != 0) {
+            return;
+        }
+
+        // Waits up to 10 ms for the handler to run on the worker
+        int count = -1;
+        for (int i = 0; i != 100; ++i) {
+            count = worker.frame_count.load(std::memory_order_acquire);
+            if (count != -1) {
+                break;
+            }
+
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+        if (count > 0) {
+            frames->assign(worker.frames, worker.frames + count);
+        }
+    }
+
+    /*! Handles triggered events, then rearms the client.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::dispatch_events(
+        ClientType* client,
+        int flags)
+    {
+        dispatched_client_ = client;
+        dispatched_client_rearmed_ = false;
+        dispatched_client_closed_ = false;
+        dispatched_client_delivered_ = false;
+
+        // Writes made by the client's handlers are sent together once the
+        // dispatch completes, before the client can be triggered elsewhere
+        if (options_.cork_writes) {
+            client->cork();
+        }
+
+        dispatch(client, flags);
+
+        dispatched_client_ = nullptr;
+
+        if (!dispatched_client_closed_) {
+            if (options_.cork_writes) {
+                client->uncork();
+            }
+
+            client->update_receive_low_watermark();
+            track(client, dispatched_client_delivered_, flags & EPOLLOUT);
+        }
+
+        if (dispatched_client_closed_) {
+            recycle(client);
+            return;
+        }
+
+        // A relayed client is armed for whatever its relay waits on
+        if (slot_of(client).relay != nullptr) {
+            arm(client, false);
+            return;
+        }
+
+        // A client filling a read-into buffer, or holding part of a framed
+        // message, is rearmed by the pool, as no handler is called until
+        // the buffer or message is complete. A write event alone leaves the
+        // read interest as it was.
+        constexpr int kReadEvents = EPOLLIN | EPOLLRDHUP | EPOLLPRI;
+        const bool awaiting
+            = client->reading_into()
+              || (options_.framer && !dispatched_client_delivered_);
+        const bool read = dispatched_client_rearmed_ || awaiting
+                          || (!(flags & kReadEvents) && client->read_armed());
+
+        // A client retiring once idle is armed for the peer's close
+        const bool retired = retire_if_idle(client);
+
+        // Queued writes are sent as the socket becomes writable
+        if (read || retired || client->pending_output_size() > 0) {
+            arm(client, read);
+        }
+    }
+
+    /*! Runs the expired callbacks of a client.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::run_timers(ClientType* client)
+    {
+        ClientSlot& slot = slot_of(client);
+        const int uuid
+            = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+
+        bool timed_out = false;
         {
-            /* Not implemented in packet sink */
+            // Callbacks were cancelled as the client closed
+            std::lock_guard<util::Mutex> l(timers_lock_);
+            if ((slot.due_head == kNoRecord && !slot.timed_out
+                 && !slot.retire_due)
+                || is_closed(client)) {
+                return;
+            }
+
+            timed_out = slot.timed_out;
+            slot.timed_out = false;
+            if (slot.retire_due) {
+                slot.retire_due = false;
+                slot.retiring = true;
+            }
         }
 
-        //! @param client
-        //!     Triggered client
-        //! @param data
-        //!     Received message data
-        //! @param size
-        //!     Received message data size
-        template <typename q_t = PacketSinkType>
-        typename std::enable_if<
-            std::is_base_of_v<
-                enable_client_data_received<PacketSinkType, ClientType>,
-                q_t>,
-            void>::type
-        have_client_data_received(ClientType* client,
-                                  const char* data,
-                                  const int size)
-        {
-            const int uuid
-                = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+        dispatched_client_ = client;
+        dispatched_client_rearmed_ = false;
+        dispatched_client_closed_ = false;
+        dispatched_by_timer_ = true;
+        dispatched_client_shut_down_ = false;
+
+        if (options_.cork_writes) {
+            client->cork();
+        }
+
+        if (timed_out) {
+            FSERV_TRACE(timeout, kTimeout, uuid, 0);
+
+            // Shutting down aborts a connect in progress, which then
+            // completes with this error
+            if (slot.connecting.load(std::memory_order_relaxed)) {
+                slot.connect_error = ETIMEDOUT;
+            }
+
+            terminate(client);
+        }
+
+        // Callbacks left once the client shuts down are cancelled as it
+        // closes
+        while (!dispatched_client_shut_down_) {
+            std::uint32_t index = kNoRecord;
+            TimerRecord* record = nullptr;
+            {
+                std::lock_guard<util::Mutex> l(timers_lock_);
+                index = slot.due_head;
+                if (index == kNoRecord) {
+                    break;
+                }
+
+                record = &timer_records_[index];
+                slot.due_head = record->next_due;
+                if (slot.due_head == kNoRecord) {
+                    slot.due_tail = kNoRecord;
+                }
+
+                if (record->cancelled) {
+                    release_record(index);
+                    continue;
+                }
+
+                record->running = true;
+            }
 
+            // Only this worker touches the callback until it is released
             ClientSession<ClientType> session(client, uuid);
-            packet_sink_->client_data_received(session, data, size);
+            record->callback(session);
+
+            std::lock_guard<util::Mutex> l(timers_lock_);
+            record->running = false;
+            if (record->uuid == -1) {
+                // Unlinked as the client's callbacks were cancelled meanwhile
+                free_record(index);
+            } else if (record->cancelled || record->interval == 0) {
+                release_record(index);
+            } else {
+                record->handle = schedule(now_ms() + record->interval,
+                                          TimerKey{uuid, index});
+            }
         }
 
-        //! EPOLLPRI event handler
-        inline void pri_read_ready_triggered(ClientType*);
+        // A buffer posted by a callback takes the bytes held back, and is
+        // completed if they fill it, as no read may follow
+        if (!dispatched_client_shut_down_ && client->reading_into()
+            && client->buffered_size() > 0 && !deliver(client, nullptr, 0)) {
+            terminate(client);
+        }
 
-        //! EPOLLIN event handler
-        inline void read_ready_triggered(ClientType*);
-    };
+        dispatched_client_ = nullptr;
+        dispatched_by_timer_ = false;
 
-    /*! Reactivates client for next read.
+        if (options_.cork_writes) {
+            client->uncork();
+        }
+
+        track(client, false, false);
+        const bool retired = !dispatched_client_shut_down_
+                             && retire_if_idle(client);
+
+        // A registered client is left as it is: rearming it could raise a
+        // second event for it. Its next event arms reads if requested.
+        if (dispatched_client_rearmed_) {
+            client->set_read_armed(true);
+        }
+
+        if (!(slot.state.load(std::memory_order_acquire) & kArmed)
+            && (dispatched_client_rearmed_ || dispatched_client_shut_down_
+                || retired || client->pending_output_size() > 0)) {
+            arm(client, dispatched_client_rearmed_);
+        }
+    }
+
+    /*! Handles triggered event.
      */
     template <typename PacketSinkType, typename ClientType>
-    void ClientPool<PacketSinkType, ClientType>::rearm(ClientType* client)
+    void ClientPool<PacketSinkType, ClientType>::dispatch(ClientType* client,
+                                                          int flags)
     {
-        const int sfd = static_cast<util::StackNode<ClientType>*>(client)->sfd;
+        if (slot_of(client).connecting.load(std::memory_order_relaxed)) {
+            connect_triggered(client, flags);
+            return;
+        }
 
-        constexpr int kFlags = EPOLLIN | EPOLLET | EPOLLHUP | EPOLLRDHUP
-                               | EPOLLPRI | EPOLLONESHOT;
-        epoll_.rearm(client, sfd, kFlags);
+        if (slot_of(client).relay != nullptr) {
+            relay_triggered(client, flags);
+            return;
+        }
+
+        if (flags & EPOLLERR) {
+            terminate_on_error(client);
+            return;
+        }
+
+        if ((flags & EPOLLHUP) || (flags & EPOLLRDHUP)) {
+            notify_closed(client);
+            terminate_on_close(client);
+            return;
+        }
+
+        if (flags & EPOLLOUT) {
+            const int pending = client->pending_output_size();
+            client->flush();
+            FSERV_TRACE(write,
+                        kWrite,
+                        static_cast<util::StackNode<ClientType>*>(client)->uuid,
+                        pending - client->pending_output_size());
+        }
+
+        if (flags & EPOLLPRI) {
+            touch(client);
+            pri_read_ready_triggered(client);
+        }
+
+        if ((flags & EPOLLIN) && !is_closed(client)) {
+            touch(client);
+            read_ready_triggered(client);
+        }
     }
 
-    /*! Closes socket and pushes client to free stack.
+    /*! Expires due timers.
      */
     template <typename PacketSinkType, typename ClientType>
-    void ClientPool<PacketSinkType, ClientType>::terminate(ClientType* client)
+    void ClientPool<PacketSinkType, ClientType>::timer_triggered()
     {
-        const int sfd = static_cast<util::StackNode<ClientType>*>(client)->sfd;
+        std::vector<int>& expired = expired_clients_;
+        expired.clear();
+        std::vector<int>& sampled = sampled_clients_;
+        sampled.clear();
+        std::vector<int>& woken = woken_clients_;
+        woken.clear();
+
+        // The coarse clock may lag the timer that has just expired
+        util::CoarseClock::refresh_precise();
+
+        std::unique_lock<util::Mutex> l(timers_lock_);
+
+        const std::int64_t now = now_ms();
+        timers_.advance(now, [this, now, &expired, &sampled](TimerKey key) {
+            if (key.uuid == kSampler) {
+                take_sample_batch(now, &sampled);
+                return;
+            }
 
-        if (sfd == 0) {
-            return;
+            ClientSlot& slot = slots_[key.uuid];
+
+            if (key.record == kRelayWakeup) {
+                slot.relay_timer = Wheel::kNullHandle;
+                woken_clients_.push_back(key.uuid);
+                return;
+            }
+
+            // Expired callbacks and deadlines are handled by the worker
+            // serving the client
+            bool queued = slot.due_head != kNoRecord || slot.timed_out
+                          || slot.retire_due;
+
+            if (key.record != kNoRecord) {
+                TimerRecord& record = timer_records_[key.record];
+                record.handle = Wheel::kNullHandle;
+                record.next_due = kNoRecord;
+
+                if (slot.due_tail == kNoRecord) {
+                    slot.due_head = key.record;
+                } else {
+                    timer_records_[slot.due_tail].next_due = key.record;
+                }
+
+                slot.due_tail = key.record;
+                if (!queued) {
+                    expired.push_back(key.uuid);
+                }
+
+                return;
+            }
+
+            slot.deadline_timer = Wheel::kNullHandle;
+
+            // Maximum age reached, the client retires once idle
+            if (slot.retire_at != 0 && slot.retire_at <= now) {
+                slot.retire_at = 0;
+                slot.retire_due = true;
+                if (!queued) {
+                    expired.push_back(key.uuid);
+                    queued = true;
+                }
+            }
+
+            // Progress since the check was scheduled pushes it back
+            const std::int64_t deadline = next_deadline(slot, now);
+            if (deadline == -1) {
+                return;
+            }
+
+            if (deadline != 0) {
+                slot.deadline_timer = timers_.schedule(deadline, key);
+                return;
+            }
+
+            slot.timed_out = true;
+            if (!queued) {
+                expired.push_back(key.uuid);
+            }
+        });
+
+        timer_deadline_ = timers_.next_expiry();
+        epoll_.set_timer(timer_deadline_ == -1 ? -1 : timer_deadline_ - now);
+        l.unlock();
+        epoll_.rearm_timer();
+
+        // Callbacks run outside the lock, so that they may schedule others.
+        // A client served by another worker has them run by that worker.
+        for (const int uuid: expired) {
+            ClientType* client = &mem_pool_.ptr_to_mem_slab[uuid];
+            if (enter(slots_[uuid], kTimersDue)) {
+                serve(client, 0, true);
+            }
         }
 
-        // Close socket descriptor
-        util::endpoint_close(sfd);
-        epoll_.remove(sfd);
-        // Clear
-        static_cast<util::StackNode<ClientType>*>(client)->sfd = 0;
+        // A relayed client acts on its relay as when kicked by a worker, or
+        // is left to the worker serving it
+        for (const int uuid: woken) {
+            ClientType* client = &mem_pool_.ptr_to_mem_slab[uuid];
+            if (enter(slots_[uuid], kRelayEvents)) {
+                serve(client,
+                      slots_[uuid].relay != nullptr ? kRelayEvents : 0,
+                      false);
+            }
+        }
 
-        /* No callback */
+        // A client served by another worker is skipped, to be sampled in
+        // the next round, rather than waited for
+        for (const int uuid: sampled) {
+            ClientType* client = &mem_pool_.ptr_to_mem_slab[uuid];
+            if (!enter(slots_[uuid], 0)) {
+                continue;
+            }
 
-        // Push back to stack of ready clients
-        clients_stack_.push(client);
+            if (!is_closed(client)) {
+                sample_tcp_info(client);
+            }
+
+            serve(client, 0, false);
+        }
     }
 
-    /*! Closes socket and pushes client to free stack.
+    /*! Schedules a callback on a client.
      */
     template <typename PacketSinkType, typename ClientType>
-    void ClientPool<PacketSinkType, ClientType>::terminate_on_close(
-        ClientType* client)
+    TimerId ClientPool<PacketSinkType, ClientType>::schedule_timer(
+        ClientType* client,
+        std::chrono::milliseconds delay,
+        std::chrono::milliseconds interval,
+        TimerCallback<ClientType>&& callback)
     {
-        const int sfd = static_cast<util::StackNode<ClientType>*>(client)->sfd;
+        if (is_closed(client)) {
+            return TimerId();
+        }
 
-        if (sfd == 0) {
+        const int uuid
+            = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+        ClientSlot& slot = slots_[uuid];
+
+        std::lock_guard<util::Mutex> l(timers_lock_);
+
+        std::uint32_t index = free_record_;
+        if (index == kNoRecord) {
+            index = static_cast<std::uint32_t>(timer_records_.size());
+            timer_records_.emplace_back();
+        } else {
+            free_record_ = timer_records_[index].next;
+        }
+
+        TimerRecord& record = timer_records_[index];
+        record.callback = std::move(callback);
+        record.interval = interval.count() > 0 ? interval.count() : 0;
+        record.uuid = uuid;
+
+        // Linked to the client, for the callback to be cancelled as the
+        // client closes
+        record.prev = kNoRecord;
+        record.next = slot.records;
+        if (record.next != kNoRecord) {
+            timer_records_[record.next].prev = index;
+        }
+
+        slot.records = index;
+
+        record.handle
+            = schedule(now_ms() + delay.count(), TimerKey{uuid, index});
+        return TimerId{index, record.sequence};
+    }
+
+    /*! Cancels a scheduled callback.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::cancel_timer(
+        ClientType* client,
+        TimerId id)
+    {
+        const int uuid
+            = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+
+        std::lock_guard<util::Mutex> l(timers_lock_);
+        if (id.record >= timer_records_.size()) {
             return;
         }
 
-        // Close socket descriptor
-        util::endpoint_close(sfd);
-        epoll_.remove(sfd);
-        // Clear
-        static_cast<util::StackNode<ClientType>*>(client)->sfd = 0;
+        TimerRecord& record = timer_records_[id.record];
+        if (record.sequence != id.sequence || record.uuid != uuid
+            || !record.callback) {
+            return;
+        }
 
-        // Trigger callback
-        have_client_closed(client);
+        // Expired callbacks are dropped by the worker about to run them
+        if (record.handle == Wheel::kNullHandle) {
+            record.cancelled = true;
+            return;
+        }
+
+        timers_.cancel(record.handle);
+        release_record(id.record);
+    }
+
+    /*! Destroys client and pushes it to free stack.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ClientPool<PacketSinkType, ClientType>::recycle(ClientType* client,
+                                                         bool release)
+    {
+        // Client is being dispatched on this thread, defer until the dispatch
+        // completes so that the slot is not reused while still referenced
+        if (client == dispatched_client_) {
+            dispatched_client_closed_ = true;
+            return;
+        }
+
+        client->~ClientType();
+
+        // Reset here rather than as the next client is registered, as its
+        // accepted handler may set one first
+        ClientSlot& slot = slot_of(client);
+        slot.handler = nullptr;
+        slot.handler_closed = false;
+
+        // Work left for the closed client does not carry over to the next.
+        // A claim released here ends before the slot can be reused.
+        slot.state.fetch_and(release ? 0 : kBusy, std::memory_order_acq_rel);
 
-        // Push back to stack of ready clients
         clients_stack_.push(client);
     }
 
-    /*! Closes socket and pushes client to free stack.
+    /*! Completes an outbound connect.
      */
     template <typename PacketSinkType, typename ClientType>
-    void ClientPool<PacketSinkType, ClientType>::terminate_on_error(
-        ClientType* client)
+    void ClientPool<PacketSinkType, ClientType>::connect_triggered(
+        ClientType* client,
+        int flags)
     {
+        ClientSlot& slot = slot_of(client);
         const int sfd = static_cast<util::StackNode<ClientType>*>(client)->sfd;
+        const int uuid
+            = static_cast<util::StackNode<ClientType>*>(client)->uuid;
+
+        int error = slot.connect_error;
+        if (error == 0) {
+            socklen_t size = sizeof(error);
+            if (::getsockopt(sfd, SOL_SOCKET, SO_ERROR, &error, &size) != 0) {
+                error = errno;
+            }
+        }
 
-        if (sfd == 0) {
-            return;
+        if (error == 0 && (flags & (EPOLLERR | EPOLLHUP))) {
+            error = ECONNABORTED;
         }
 
-        // Close socket descriptor
-        util::endpoint_close(sfd);
-        epoll_.remove(sfd);
-        // Clear
-        static_cast<util::StackNode<ClientType>*>(client)->sfd = 0;
+        FSERV_TRACE(connect, kConnect, uuid, error);
 
-        // Trigger callback
-        have_client_error(client);
+        slot.connecting.store(false, std::memory_order_relaxed);
+        ConnectCallback<ClientType> callback = std::move(slot.on_connected);
+        touch(client);
 
-        // Push back to stack of ready clients
-        clients_stack_.push(client);
+        if (callback) {
+            ClientSession<ClientType> session(client, uuid);
+            callback(session, error);
+        }
+
+        if (error != 0) {
+            terminate(client);
+            return;
+        }
+
+        // Established, reads are armed as the dispatch completes
+        if (!is_closed(client)) {
+            dispatched_client_rearmed_ = true;
+        }
     }
 
-    /*! Called on triggered event.
+    /*! Moves relayed bytes on a relayed client's events.
      */
     template <typename PacketSinkType, typename ClientType>
-    void ClientPool<PacketSinkType, ClientType>::trigger(ClientType* client,
-                                                         int flags)
+    void ClientPool<PacketSinkType, ClientType>::relay_triggered(
+        ClientType* client,
+        int flags)
     {
+        ClientSlot& slot = slot_of(client);
+        Relay* relay = slot.relay;
+        const int side = slot.relay_side;
+
+        touch(client);
+
+        // Requested as the client was accepted
+        if (relay->deferred) {
+            relay->deferred = false;
+            if (!start_relay(relay)) {
+                fail(relay);
+            }
+        }
+
         if (flags & EPOLLERR) {
-            terminate_on_error(client);
-            return;
+            fail(relay);
         }
 
-        if ((flags & EPOLLHUP) || (flags & EPOLLRDHUP)) {
-            have_client_closed(client);
-            terminate_on_close(client);
-            return;
+        // Output written before the relay started goes ahead of relayed
+        // bytes
+        bool sent = false;
+        if (relay->queued[side].load(std::memory_order_relaxed)) {
+            client->flush();
+            if (client->pending_output_size() == 0) {
+                relay->queued[side].store(false, std::memory_order_release);
+                sent = true;
+            }
         }
 
-        if (flags & EPOLLPRI) {
-            timeout_timer_.set(client);
-            pri_read_ready_triggered(client);
+        if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+            pump(relay, side, side);
         }
 
-        if (flags & EPOLLIN) {
-            timeout_timer_.set(client);
-            read_ready_triggered(client);
+        if (sent || (flags & (EPOLLOUT | EPOLLHUP))) {
+            pump(relay, 1 - side, side);
+        }
+
+        if (relay->failed.load(std::memory_order_acquire)) {
+            terminate_on_error(client);
+            return;
+        }
+
+        // Nothing more to read from the client, and all bytes for it sent
+        if (relay->directions[side].eof.load(std::memory_order_acquire)
+            && relay->directions[1 - side].done.load(
+                std::memory_order_acquire)) {
+            terminate_on_close(client);
         }
     }
 
@@ -496,6 +3166,19 @@ namespace fserv {
     void ClientPool<PacketSinkType, ClientType>::read_ready_triggered(
         ClientType* const client)
     {
+        // A buffer posted outside a delivery, such as from a timer callback,
+        // takes the bytes held back before any that are read next
+        if (client->reading_into() && client->buffered_size() > 0) {
+            if (!deliver(client, nullptr, 0)) {
+                terminate_on_error(client);
+                return;
+            }
+
+            if (is_closed(client) || slot_of(client).relay != nullptr) {
+                return;
+            }
+        }
+
         while (true) {
             // Read incoming message
             int nbytes = -1;
@@ -519,8 +3202,109 @@ namespace fserv {
 
             // Have actual data
             // Process it...
-            have_client_data_received(client, data, nbytes);
+            FSERV_TRACE(read,
+                        kRead,
+                        static_cast<util::StackNode<ClientType>*>(client)->uuid,
+                        nbytes);
+
+            ClientSlot& slot = slot_of(client);
+            if (!slot.received.load(std::memory_order_relaxed)) {
+                slot.received.store(true, std::memory_order_relaxed);
+            }
+
+            const int spilled = nbytes - client->last_read_into_size();
+            if (client->last_read_zerocopy()) {
+                have_client_zerocopy_received(client, data, nbytes);
+            } else if (!deliver(client, data, spilled)) {
+                // Protocol violation
+                terminate_on_error(client);
+                break;
+            }
+
+            // Client was terminated, or relayed, by the data handler
+            if (is_closed(client) || slot.relay != nullptr) {
+                break;
+            }
+
+            // Too much output queued, leave the rest of the input on the
+            // socket until reads resume
+            if (options_.output_high_watermark > 0
+                && client->pending_output_size()
+                       > options_.output_high_watermark) {
+                break;
+            }
+
+            // Short read, socket has been drained
+            // Any data arriving after the read is reported on rearm
+            if (options_.short_read && nbytes < client->last_read_size()) {
+                break;
+            }
+        }
+    }
+
+    /*! Hands read data to the packet sink.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    bool ClientPool<PacketSinkType, ClientType>::deliver(ClientType* client,
+                                                         const char* data,
+                                                         int size)
+    {
+        const auto on_message = [this, client](const char* message, int n) {
+            dispatched_client_delivered_ = true;
+            notify_data_received(client, message, n);
+            return !is_closed(client) && !client->reading_into();
+        };
+
+        // Bytes kept in the read ring are drained from there
+        if (client->reads_buffered()) {
+            size = 0;
+        }
+
+        while (!is_closed(client)) {
+            if (client->reading_into()) {
+                // Bytes already read but not yet framed come first
+                if (!client->read_into_full() && client->buffered_size() > 0) {
+                    client->drain_into();
+                }
+
+                if (!client->read_into_full() && size > 0) {
+                    const int n = client->fill_into(data, size);
+                    data += n;
+                    size -= n;
+                }
+
+                if (!client->read_into_full()) {
+                    break;
+                }
+
+                int buff_size = 0;
+                char* buff = client->take_read_into(&buff_size);
+                dispatched_client_delivered_ = true;
+                have_client_read_completed(client, buff, buff_size);
+                continue;
+            }
+
+            if (!options_.framer) {
+                if (size > 0) {
+                    notify_data_received(client, data, size);
+                }
+
+                break;
+            }
+
+            // Framer stops early if the handler posts a read-into buffer,
+            // leaving the remaining bytes buffered
+            if (!client->frame(options_.framer, data, size, on_message)) {
+                return false;
+            }
+
+            size = 0;
+            if (!client->reading_into()) {
+                break;
+            }
         }
+
+        return true;
     }
 
     /*! EPOLLPRI event handler
@@ -551,6 +3335,11 @@ namespace fserv {
             // Have actual data
             // Process it...
             have_client_oob_received(client, oobdata);
+
+            // Client was terminated by the data handler
+            if (is_closed(client)) {
+                break;
+            }
         }
     }
 } // namespace fserv
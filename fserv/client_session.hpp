@@ -3,6 +3,11 @@
 
 #pragma once
 
+#include "client_session_manager.hpp"
+#include "trace.hpp"
+#include <chrono>
+#include <utility>
+
 namespace fserv {
 
     //! @class ClientSession
@@ -38,7 +43,174 @@ namespace fserv {
         //!     Number of bytes written
         int write(const char* buff, const int size) const
         {
-            return client_ptr_->write(buff, size);
+            const int n = client_ptr_->write(buff, size);
+            FSERV_TRACE(write, kWrite, uuid_, n);
+            return n;
+        }
+
+        //! Writes data ahead of queued messages not yet started, such as a
+        //! priority message that should not wait behind bulk data. Urgent
+        //! messages keep their order among themselves.
+        //! @param buff
+        //!     Message buffer
+        //! @param size
+        //!     Message buffer size (bytes)
+        //! @return
+        //!     Number of bytes written or queued
+        int write_urgent(const char* buff, const int size) const
+        {
+            const int n = client_ptr_->write_urgent(buff, size);
+            FSERV_TRACE(write, kWrite, uuid_, n);
+            return n;
+        }
+
+        //! Drops queued messages not yet started.
+        //! @return
+        //!     Number of bytes dropped
+        int discard_output() const
+        {
+            return client_ptr_->discard_output();
+        }
+
+        //! @return
+        //!     Number of bytes written but not yet taken by the socket
+        int pending_output_size() const
+        {
+            return client_ptr_->pending_output_size();
+        }
+
+        //! Posts a buffer that the next reads go straight into, bypassing
+        //! the data handler, until it is full. The read completed handler is
+        //! then called with the buffer. Bytes already read but not yet
+        //! handed out are copied in first. The client is rearmed
+        //! automatically until the buffer is full.
+        //! Must be called from a handler invoked for this client.
+        //! @param buff
+        //!     Destination buffer, must remain valid until filled
+        //! @param size
+        //!     Destination buffer size (bytes)
+        void read_into(char* buff, const int size)
+        {
+            client_ptr_->read_into(buff, size);
+        }
+
+        //! Sets the number of bytes that must be queued on the socket before
+        //! the client is woken for a read, such as the size of the header
+        //! expected next. Takes effect from the next wakeup.
+        //! Must be called from a handler invoked for this client.
+        //! @param size
+        //!     Low watermark (bytes), zero for the kernel default
+        void set_receive_low_watermark(const int size)
+        {
+            client_ptr_->set_receive_low_watermark(size);
+        }
+
+        //! Releases the pages passed to the zero-copy received handler, once
+        //! the application is done with them. Until then, further data is
+        //! received by copy. May be called from any thread.
+        void release_zerocopy()
+        {
+            client_ptr_->release_zerocopy();
+        }
+
+        //! Reads the connection's latest TCP_INFO sample, taken if the pool
+        //! samples TCP_INFO, see ClientOptions::tcp_info_interval.
+        //! Must be called from a handler invoked for this client.
+        //! @return
+        //!     Latest sample, with sampled_at zero if none was taken yet
+        TcpSample tcp_sample() const
+        {
+            return client_ptr_->tcp_sample();
+        }
+
+        //! Runs a callback once after a delay, with the same exclusivity as
+        //! the client's handlers. Callbacks of up to 48 bytes are stored
+        //! without allocating. Cancelled when the client terminates.
+        //! @param delay
+        //!     Delay before the run
+        //! @param fn
+        //!     Callable taking the client session
+        //! @return
+        //!     Identifier to cancel the callback with
+        template <typename FnType>
+        TimerId run_after(std::chrono::milliseconds delay, FnType&& fn)
+        {
+            return client_ptr_->schedule_timer(
+                delay,
+                std::chrono::milliseconds::zero(),
+                TimerCallback<ClientType>(std::forward<FnType>(fn)));
+        }
+
+        //! Runs a callback repeatedly, as run_after() does.
+        //! @param interval
+        //!     Delay before the first run and between runs
+        //! @param fn
+        //!     Callable taking the client session
+        //! @return
+        //!     Identifier to cancel the callback with
+        template <typename FnType>
+        TimerId run_every(std::chrono::milliseconds interval, FnType&& fn)
+        {
+            return client_ptr_->schedule_timer(
+                interval,
+                interval,
+                TimerCallback<ClientType>(std::forward<FnType>(fn)));
+        }
+
+        //! Cancels a callback scheduled by run_after() or run_every(),
+        //! including from within the callback itself.
+        //! @param id
+        //!     Callback identifier, ignored if no longer scheduled
+        void cancel_timer(TimerId id)
+        {
+            client_ptr_->cancel_timer(id);
+        }
+
+        //! Routes the client's data and close events to a handler instead of
+        //! the server's callbacks, until the client closes. Read-into,
+        //! zero-copy and out-of-band events still go to the server's.
+        //! Must be called from a handler invoked for this client.
+        //! @param handler
+        //!     Event handler, null for the server's callbacks
+        void set_event_handler(ClientEventHandler<ClientType>* handler)
+        {
+            client_ptr_->set_event_handler(handler);
+        }
+
+        //! Relays the client to a new outbound connection, moving bytes
+        //! both ways with splice() through a pair of pipes, without copying
+        //! them through user space. Each side's end of input is passed on as
+        //! a half-close once its bytes are sent, and a side that cannot keep
+        //! up pauses reads from the other. Both clients close once both
+        //! directions are done, or as soon as either fails, and no handler
+        //! is called for them meanwhile, apart from the close or error
+        //! handler. Output already written to the client is sent first;
+        //! data already read from it is not relayed.
+        //! Must be called from a handler invoked for this client, such as
+        //! the accepted handler.
+        //! @param addr
+        //!     Remote address
+        //! @param timeouts
+        //!     Deadlines of the outbound connection, connect included
+        //! @return
+        //!     False if the connect could not be started, the client then
+        //!     being left as it was. From the accepted handler, the connect
+        //!     starts once the client is registered, and closes the client
+        //!     with an error if it cannot be started.
+        bool proxy(const sockaddr_in& addr,
+                   const ClientTimeouts& timeouts = ClientTimeouts())
+        {
+            return client_ptr_->proxy(addr, timeouts);
+        }
+
+        //! Checks, without reading, that the peer has not closed the
+        //! connection.
+        //! @return
+        //!     False if the connection is closed or has failed, true
+        //!     otherwise
+        bool peer_open() const
+        {
+            return client_ptr_->peer_open();
         }
 
         //! Reactivates the client for next read.
@@ -47,7 +219,9 @@ namespace fserv {
             client_ptr_->rearm();
         }
 
-        //! Terminates the client.
+        //! Terminates the client. May be called from any thread, a client in
+        //! a handler on another worker then being closed by that worker once
+        //! the handler returns.
         void terminate()
         {
             client_ptr_->terminate();
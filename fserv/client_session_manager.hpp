@@ -3,8 +3,65 @@
 
 #pragma once
 
+#include "buffer_pool.hpp"
+#include "client_options.hpp"
+#include "metrics.hpp"
+#include "small_function.hpp"
+#include <chrono>
+#include <cstdint>
+#include <netinet/in.h>
+
 namespace fserv {
 
+    template <typename ClientType>
+    class ClientSession;
+
+    //! Callback scheduled on a client session
+    template <typename ClientType>
+    using TimerCallback = util::SmallFunction<void(ClientSession<ClientType>&)>;
+
+    //! Called once an outbound connection is established, with a zero
+    //! error, or has failed, with the errno value
+    template <typename ClientType>
+    using ConnectCallback
+        = util::SmallFunction<void(ClientSession<ClientType>&, int)>;
+
+    //! @struct TimerId
+    /*! Identifies a callback scheduled on a client session
+     */
+    struct TimerId {
+        std::uint32_t record = ~std::uint32_t(0);
+        std::uint32_t sequence = 0;
+    };
+
+    //! @class ClientEventHandler
+    /*! Handles the data and close events of one client in place of the
+     *! pool's packet sink, such as for a connection owned by a library
+     *! component rather than by the application
+     */
+    template <typename ClientType>
+    class ClientEventHandler {
+    public:
+        virtual ~ClientEventHandler() = default;
+
+        //! Handles client data received.
+        //! @param client
+        //!     Triggered client
+        //! @param data
+        //!     Message data
+        //! @param size
+        //!     Message data size
+        virtual void client_data_received(ClientSession<ClientType>& client,
+                                          const char* data,
+                                          const int size)
+            = 0;
+
+        //! Handles client closure, error or termination, called once.
+        //! @param client
+        //!     Closing client
+        virtual void client_closed(ClientSession<ClientType>& client) = 0;
+    };
+
     //! @class ClientSessionManager
     /*! Interface for exposing session-related client pool methods
      */
@@ -22,5 +79,66 @@ namespace fserv {
         //! @param client
         //!     Client to close
         virtual void terminate(ClientType* client) = 0;
+
+        //! Schedules a callback on a client.
+        //! @param client
+        //!     Client to run the callback for
+        //! @param delay
+        //!     Delay before the first run
+        //! @param interval
+        //!     Delay between runs, zero to run once
+        //! @param callback
+        //!     Callback to run
+        //! @return
+        //!     Identifier to cancel the callback with
+        virtual TimerId schedule_timer(ClientType* client,
+                                       std::chrono::milliseconds delay,
+                                       std::chrono::milliseconds interval,
+                                       TimerCallback<ClientType>&& callback)
+            = 0;
+
+        //! Cancels a scheduled callback.
+        //! @param client
+        //!     Client the callback was scheduled on
+        //! @param id
+        //!     Callback identifier, ignored if no longer scheduled
+        virtual void cancel_timer(ClientType* client, TimerId id) = 0;
+
+        //! @return
+        //!     Tunables applied to client connections
+        virtual const ClientOptions& options() const = 0;
+
+        //! @return
+        //!     Pool from which client read buffers are drawn
+        virtual util::BufferPool* buffer_pool() = 0;
+
+        //! @param client
+        //!     Client, served by the calling worker
+        //! @return
+        //!     Client's latest TCP_INFO sample
+        virtual TcpSample tcp_sample(ClientType* client) = 0;
+
+        //! Routes a client's data and close events to a handler of its own.
+        //! @param client
+        //!     Client, served by the calling worker
+        //! @param handler
+        //!     Event handler, null for the packet sink
+        virtual void set_event_handler(ClientType* client,
+                                       ClientEventHandler<ClientType>* handler)
+            = 0;
+
+        //! Relays a client to a new outbound connection.
+        //! @param client
+        //!     Client, served by the calling worker or being accepted
+        //! @param addr
+        //!     Remote address
+        //! @param timeouts
+        //!     Deadlines of the outbound connection
+        //! @return
+        //!     False if the connect could not be started
+        virtual bool proxy(ClientType* client,
+                           const sockaddr_in& addr,
+                           const ClientTimeouts& timeouts)
+            = 0;
     };
 } // namespace fserv
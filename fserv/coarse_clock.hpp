@@ -0,0 +1,55 @@
+/* coarse_clock.hpp -- v1.0
+   Per-thread cached monotonic clock for hot-path timestamps */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+namespace fserv::util {
+
+    //! @class CoarseClock
+    /*! Monotonic milliseconds, cached per thread. Worker threads refresh
+     *! the cache once per epoll_wait() return, from CLOCK_MONOTONIC_COARSE,
+     *! so that timestamps taken while handling events cost no clock read.
+     *! Threads that never refresh it read the clock on each call. The coarse
+     *! clock advances once per scheduler tick, typically 1 to 4 ms, so that
+     *! deadlines computed from it may come due up to a tick early.
+     */
+    class CoarseClock {
+    public:
+        //! @return
+        //!     Cached time (ms), or the current time if this thread has no
+        //!     cache
+        static std::int64_t now_ms()
+        {
+            return cached_ != 0 ? cached_ : read(CLOCK_MONOTONIC_COARSE);
+        }
+
+        //! Refreshes this thread's cache from the coarse clock, which may
+        //! lag the precise clock by up to one scheduler tick.
+        static void refresh()
+        {
+            cached_ = read(CLOCK_MONOTONIC_COARSE);
+        }
+
+        //! Refreshes this thread's cache from the precise clock, for callers
+        //! that compare against deadlines a kernel timer has just reached.
+        static void refresh_precise()
+        {
+            cached_ = read(CLOCK_MONOTONIC);
+        }
+    private:
+        // Time of the last refresh (ms), zero if never refreshed
+        inline static thread_local std::int64_t cached_ = 0;
+
+        /* @helper */
+        static std::int64_t read(clockid_t clock)
+        {
+            struct timespec ts;
+            ::clock_gettime(clock, &ts);
+            return static_cast<std::int64_t>(ts.tv_sec) * 1000
+                   + ts.tv_nsec / 1000000;
+        }
+    };
+} // namespace fserv::util
@@ -0,0 +1,864 @@
+/* datagram_server.hpp -- v1.0
+   UDP server receiving and replying in batches, one socket per worker */
+
+#pragma once
+
+#include "endpoint.hpp"
+#include "epoll.hpp"
+#include "metrics.hpp"
+#include "mutex.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+namespace fserv {
+
+    //! @struct DatagramOptions
+    /*! Datagram server tunables, set before the server is run
+     */
+    struct DatagramOptions {
+        // Maximum number of datagrams received with one recvmmsg(), and of
+        // replies sent with one sendmmsg()
+        int batch_size = 64;
+
+        // Largest datagram received or queued as a reply (bytes). Longer
+        // datagrams are truncated, and counted in
+        // DatagramMetrics::truncated_count; longer replies are sent on their
+        // own.
+        int max_datagram_size = 2048;
+
+        // Socket receive buffer size (bytes, SO_RCVBUF) of each worker, zero
+        // for the kernel default
+        int receive_buffer_size = 0;
+
+        // Whether the kernel may coalesce datagrams of the same flow into
+        // one buffer (UDP_GRO), handed to the callback with their size in
+        // DatagramSession::segment_size(). Each batch slot is then sized
+        // for the largest coalesced buffer, 64 KiB.
+        bool gro = false;
+    };
+
+    class DatagramWorker;
+
+    //! @class DatagramSession
+    /*! Datagram being handled, used for replying to its sender
+     */
+    class DatagramSession {
+    public:
+        //! Ctor.
+        //! @param worker
+        //!     Worker that received the datagram
+        //! @param peer
+        //!     Sender address
+        //! @param segment_size
+        //!     Size of each datagram coalesced into the buffer received
+        //!     (bytes), zero if it holds a single datagram
+        DatagramSession(DatagramWorker* worker,
+                        const sockaddr_in& peer,
+                        int segment_size = 0)
+            : worker_(worker)
+            , peer_(peer)
+            , segment_size_(segment_size)
+        {}
+
+        //! @return
+        //!     Sender address
+        const sockaddr_in& peer() const
+        {
+            return peer_;
+        }
+
+        //! @return
+        //!     Index of the worker that received the datagram
+        int worker() const;
+
+        //! @return
+        //!     Size of each datagram in the buffer received (bytes), the
+        //!     last one possibly shorter, or zero if the buffer holds a
+        //!     single datagram
+        int segment_size() const
+        {
+            return segment_size_;
+        }
+
+        //! Queues a reply to the sender, sent with the replies to the rest
+        //! of the batch once the callback has been called for all of it.
+        //! @param buff
+        //!     Message buffer, copied
+        //! @param size
+        //!     Message buffer size (bytes)
+        //! @return
+        //!     True if the reply was queued or sent, false otherwise
+        bool reply(const char* buff, int size) const;
+
+        //! Queues a datagram to any address, as reply() does.
+        //! @param addr
+        //!     Destination address
+        //! @param buff
+        //!     Message buffer, copied
+        //! @param size
+        //!     Message buffer size (bytes)
+        //! @return
+        //!     True if the datagram was queued or sent, false otherwise
+        bool send_to(const sockaddr_in& addr, const char* buff, int size) const;
+
+        //! Sends a buffer to the sender as datagrams of segment_size bytes,
+        //! the last one possibly shorter, split by the kernel (UDP_SEGMENT).
+        //! Replies queued before it are sent first.
+        //! @param buff
+        //!     Message buffer
+        //! @param size
+        //!     Message buffer size (bytes)
+        //! @param segment_size
+        //!     Datagram size (bytes)
+        //! @return
+        //!     True if all datagrams were sent, false otherwise
+        bool reply_segmented(const char* buff,
+                             int size,
+                             int segment_size) const;
+
+        //! Sends a buffer to any address, as reply_segmented() does.
+        //! @param addr
+        //!     Destination address
+        //! @param buff
+        //!     Message buffer
+        //! @param size
+        //!     Message buffer size (bytes)
+        //! @param segment_size
+        //!     Datagram size (bytes)
+        //! @return
+        //!     True if all datagrams were sent, false otherwise
+        bool send_segmented_to(const sockaddr_in& addr,
+                               const char* buff,
+                               int size,
+                               int segment_size) const;
+    private:
+        // Worker that received the datagram
+        DatagramWorker* worker_ = nullptr;
+        // Sender address
+        sockaddr_in peer_ = {};
+        // Size of each coalesced datagram, zero if not coalesced
+        int segment_size_ = 0;
+    };
+
+    //! Called with each datagram received
+    using DatagramCallback
+        = std::function<void(DatagramSession&, const char*, const int)>;
+
+    //! @class DatagramWorker
+    /*! Drains one SO_REUSEPORT socket with recvmmsg(), handing each
+     *! datagram to the callback, and sends the replies queued meanwhile with
+     *! sendmmsg()
+     */
+    class DatagramWorker {
+        // Largest buffer the kernel coalesces (UDP_GRO) or splits
+        // (UDP_SEGMENT), and most datagrams it splits one buffer into
+        static constexpr int kMaxOffloadSize = 65535;
+        static constexpr int kMaxSegmentedSize = 65507;
+        static constexpr int kMaxSegmentCount = 64;
+        // Room for a UDP_GRO control message
+        static constexpr int kControlSize = CMSG_SPACE(sizeof(int));
+    public:
+        //! Ctor.
+        //! @param index
+        //!     Worker index
+        //! @param sfd
+        //!     Non-blocking UDP socket, owned by the caller
+        //! @param options
+        //!     Tunables
+        //! @param callback
+        //!     Callback called with each datagram received
+        DatagramWorker(int index,
+                       int sfd,
+                       const DatagramOptions& options,
+                       std::shared_ptr<const DatagramCallback> callback)
+            : index_(index)
+            , sfd_(sfd)
+            , batch_size_(options.batch_size > 0 ? options.batch_size : 1)
+            , max_datagram_size_(options.max_datagram_size)
+            , recv_slot_size_(options.gro ? kMaxOffloadSize
+                                          : options.max_datagram_size)
+            , gro_(options.gro)
+            , callback_(std::move(callback))
+            , recv_buffers_(static_cast<std::size_t>(batch_size_)
+                            * recv_slot_size_)
+            , recv_controls_(gro_ ? batch_size_ * kControlSize : 0)
+            , recv_msgs_(batch_size_)
+            , recv_iovs_(batch_size_)
+            , recv_addrs_(batch_size_)
+            , send_buffers_(batch_size_ * max_datagram_size_)
+            , send_msgs_(batch_size_)
+            , send_iovs_(batch_size_)
+            , send_addrs_(batch_size_)
+        {
+            for (int i = 0; i != batch_size_; ++i) {
+                recv_iovs_[i].iov_base
+                    = &recv_buffers_[static_cast<std::size_t>(i)
+                                     * recv_slot_size_];
+                recv_iovs_[i].iov_len = recv_slot_size_;
+                recv_msgs_[i].msg_hdr.msg_iov = &recv_iovs_[i];
+                recv_msgs_[i].msg_hdr.msg_iovlen = 1;
+                recv_msgs_[i].msg_hdr.msg_name = &recv_addrs_[i];
+
+                send_iovs_[i].iov_base = &send_buffers_[i * max_datagram_size_];
+                send_msgs_[i].msg_hdr.msg_iov = &send_iovs_[i];
+                send_msgs_[i].msg_hdr.msg_iovlen = 1;
+                send_msgs_[i].msg_hdr.msg_name = &send_addrs_[i];
+                send_msgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            }
+        }
+
+        //! Waits for datagrams until stopped.
+        //! @return
+        //!     False if the socket could not be watched, true otherwise
+        bool run()
+        {
+            if (!epoll_.add(this, sfd_, EPOLLIN)) {
+                return false;
+            }
+
+            epoll_.wait(this);
+            epoll_.remove(sfd_);
+            return true;
+        }
+
+        //! Stops waiting for datagrams, from any thread.
+        void stop()
+        {
+            epoll_.close();
+        }
+
+        //! Drains the socket.
+        //! @param worker
+        //!     This worker
+        //! @param flags
+        //!     Epoll events
+        void trigger(DatagramWorker* worker, int flags)
+        {
+            (void)worker;
+            (void)flags;
+
+            for (;;) {
+                for (int i = 0; i != batch_size_; ++i) {
+                    recv_msgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+                    if (gro_) {
+                        recv_msgs_[i].msg_hdr.msg_control
+                            = &recv_controls_[i * kControlSize];
+                        recv_msgs_[i].msg_hdr.msg_controllen = kControlSize;
+                    }
+                }
+
+                const int n = ::recvmmsg(sfd_,
+                                         recv_msgs_.data(),
+                                         batch_size_,
+                                         MSG_DONTWAIT,
+                                         nullptr);
+                if (n <= 0) {
+                    break;
+                }
+
+                batch_sizes_.record(n);
+                for (int i = 0; i != n; ++i) {
+                    const int flags = recv_msgs_[i].msg_hdr.msg_flags;
+
+                    // Without its control message, a coalesced buffer would
+                    // pass for a single datagram
+                    if (gro_ && (flags & MSG_CTRUNC)) {
+                        truncated_count_.fetch_add(1,
+                                                   std::memory_order_relaxed);
+                        continue;
+                    }
+
+                    if (flags & MSG_TRUNC) {
+                        truncated_count_.fetch_add(1,
+                                                   std::memory_order_relaxed);
+                    }
+
+                    const int size = static_cast<int>(recv_msgs_[i].msg_len);
+                    int segment_size = gro_ ? read_segment_size(i) : 0;
+                    if (segment_size >= size) {
+                        segment_size = 0;
+                    }
+
+                    if (segment_size > 0) {
+                        received_count_.fetch_add(
+                            (size + segment_size - 1) / segment_size,
+                            std::memory_order_relaxed);
+                        coalesced_count_.fetch_add(1,
+                                                   std::memory_order_relaxed);
+                    }
+                    else {
+                        received_count_.fetch_add(1,
+                                                  std::memory_order_relaxed);
+                    }
+
+                    DatagramSession session(this, recv_addrs_[i], segment_size);
+                    const auto* data
+                        = static_cast<const char*>(recv_iovs_[i].iov_base);
+                    (*callback_)(session, data, size);
+                }
+
+                flush();
+
+                // A short batch drained the socket
+                if (n < batch_size_) {
+                    break;
+                }
+            }
+        }
+
+        //! Queues a datagram, sent with the next flush.
+        //! @param addr
+        //!     Destination address
+        //! @param buff
+        //!     Message buffer, copied
+        //! @param size
+        //!     Message buffer size (bytes)
+        //! @return
+        //!     True if the datagram was queued or sent, false otherwise
+        bool queue(const sockaddr_in& addr, const char* buff, int size)
+        {
+            if (size > max_datagram_size_) {
+                const auto n
+                    = ::sendto(sfd_,
+                               buff,
+                               size,
+                               MSG_DONTWAIT,
+                               reinterpret_cast<const sockaddr*>(&addr),
+                               sizeof(addr));
+                if (n != size) {
+                    dropped_count_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                sent_count_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            if (send_count_ == batch_size_) {
+                flush();
+            }
+
+            std::memcpy(send_iovs_[send_count_].iov_base, buff, size);
+            send_iovs_[send_count_].iov_len = size;
+            send_addrs_[send_count_] = addr;
+            ++send_count_;
+            return true;
+        }
+
+        //! Sends a buffer as datagrams of segment_size bytes, split by the
+        //! kernel, after the datagrams queued so far.
+        //! @param addr
+        //!     Destination address
+        //! @param buff
+        //!     Message buffer
+        //! @param size
+        //!     Message buffer size (bytes)
+        //! @param segment_size
+        //!     Datagram size (bytes)
+        //! @return
+        //!     True if all datagrams were sent, false otherwise
+        bool send_segmented(const sockaddr_in& addr,
+                            const char* buff,
+                            int size,
+                            int segment_size)
+        {
+            if (segment_size <= 0 || segment_size > kMaxSegmentedSize) {
+                return false;
+            }
+
+            if (size <= segment_size) {
+                return queue(addr, buff, size);
+            }
+
+            // Keep datagrams to the same peer in order
+            flush();
+
+            // The kernel splits up to 64 segments, and 64 KiB, per call
+            const int max_chunk
+                = std::min(kMaxSegmentCount, kMaxSegmentedSize / segment_size)
+                  * segment_size;
+
+            bool sent_all = true;
+            for (int offset = 0; offset < size;) {
+                const int chunk = std::min(max_chunk, size - offset);
+                const int count = (chunk + segment_size - 1) / segment_size;
+
+                if (gso_) {
+                    const int n = util::endpoint_write_segmented(
+                        sfd_, addr, buff + offset, chunk, segment_size);
+                    if (n == chunk) {
+                        sent_count_.fetch_add(count, std::memory_order_relaxed);
+                        segmented_count_.fetch_add(1,
+                                                   std::memory_order_relaxed);
+                        offset += chunk;
+                        continue;
+                    }
+
+                    // Not supported by the kernel or the route's device;
+                    // split in user space from now on
+                    if (n == -1
+                        && (errno == EINVAL || errno == EIO
+                            || errno == ENOPROTOOPT)) {
+                        gso_ = false;
+                    }
+                    else {
+                        dropped_count_.fetch_add(count,
+                                                 std::memory_order_relaxed);
+                        sent_all = false;
+                        offset += chunk;
+                        continue;
+                    }
+                }
+
+                for (int i = 0; i < chunk; i += segment_size) {
+                    sent_all &= queue(addr,
+                                      buff + offset + i,
+                                      std::min(segment_size, chunk - i));
+                }
+
+                offset += chunk;
+            }
+
+            return sent_all;
+        }
+
+        //! @return
+        //!     Worker index
+        int index() const
+        {
+            return index_;
+        }
+
+        //! @return
+        //!     Number of datagrams received
+        std::uint64_t received_count() const
+        {
+            return received_count_.load(std::memory_order_relaxed);
+        }
+
+        //! @return
+        //!     Number of datagrams sent
+        std::uint64_t sent_count() const
+        {
+            return sent_count_.load(std::memory_order_relaxed);
+        }
+
+        //! @return
+        //!     Number of datagrams the socket did not take
+        std::uint64_t dropped_count() const
+        {
+            return dropped_count_.load(std::memory_order_relaxed);
+        }
+
+        //! @return
+        //!     Number of datagrams received truncated, or dropped as their
+        //!     coalescing details were cut
+        std::uint64_t truncated_count() const
+        {
+            return truncated_count_.load(std::memory_order_relaxed);
+        }
+
+        //! @return
+        //!     Number of coalesced buffers received
+        std::uint64_t coalesced_count() const
+        {
+            return coalesced_count_.load(std::memory_order_relaxed);
+        }
+
+        //! @return
+        //!     Number of buffers sent split by the kernel
+        std::uint64_t segmented_count() const
+        {
+            return segmented_count_.load(std::memory_order_relaxed);
+        }
+
+        //! @return
+        //!     Datagrams received per recvmmsg()
+        util::Histogram::Snapshot batch_sizes() const
+        {
+            return batch_sizes_.snapshot();
+        }
+
+        // Non-copyable object
+        DatagramWorker(const DatagramWorker&) = delete;
+        DatagramWorker& operator=(const DatagramWorker&) = delete;
+    private:
+        // Worker index
+        int index_ = 0;
+        // Socket
+        int sfd_ = -1;
+        // Datagrams per system call
+        int batch_size_ = 0;
+        // Size of each datagram buffer (bytes)
+        int max_datagram_size_ = 0;
+        // Size of each receive buffer (bytes), larger with GRO
+        int recv_slot_size_ = 0;
+        // Whether coalesced datagrams are received
+        bool gro_ = false;
+        // Whether the kernel splits segmented sends, until it refuses to
+        bool gso_ = true;
+        // Callback called with each datagram received
+        std::shared_ptr<const DatagramCallback> callback_;
+
+        // Receive batch, one buffer, message header and sender per datagram
+        std::vector<char> recv_buffers_;
+        std::vector<char> recv_controls_;
+        std::vector<mmsghdr> recv_msgs_;
+        std::vector<iovec> recv_iovs_;
+        std::vector<sockaddr_in> recv_addrs_;
+
+        // Send batch, filled up to send_count_
+        std::vector<char> send_buffers_;
+        std::vector<mmsghdr> send_msgs_;
+        std::vector<iovec> send_iovs_;
+        std::vector<sockaddr_in> send_addrs_;
+        int send_count_ = 0;
+
+        // Statistics, read from any thread
+        std::atomic<std::uint64_t> received_count_ = 0;
+        std::atomic<std::uint64_t> sent_count_ = 0;
+        std::atomic<std::uint64_t> dropped_count_ = 0;
+        std::atomic<std::uint64_t> truncated_count_ = 0;
+        std::atomic<std::uint64_t> coalesced_count_ = 0;
+        std::atomic<std::uint64_t> segmented_count_ = 0;
+        util::Histogram batch_sizes_;
+
+        // Epoll instance watching the socket alone
+        EpollWaiter<DatagramWorker, DatagramWorker> epoll_{1};
+
+        /* @helper */
+        int read_segment_size(int i)
+        {
+            msghdr& hdr = recv_msgs_[i].msg_hdr;
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr;
+                 cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+                if (cmsg->cmsg_level == SOL_UDP
+                    && cmsg->cmsg_type == UDP_GRO) {
+                    int segment_size = 0;
+                    std::memcpy(&segment_size,
+                                CMSG_DATA(cmsg),
+                                sizeof(segment_size));
+                    return segment_size;
+                }
+            }
+
+            return 0;
+        }
+
+        /* @helper */
+        void flush()
+        {
+            // Datagrams sent or dropped, and those sent
+            int done = 0;
+            int sent = 0;
+            while (done != send_count_) {
+                const int n = ::sendmmsg(sfd_,
+                                         &send_msgs_[done],
+                                         send_count_ - done,
+                                         MSG_DONTWAIT);
+                if (n > 0) {
+                    done += n;
+                    sent += n;
+                    continue;
+                }
+
+                // The socket buffer is full, or the next datagram failed,
+                // such as for an unreachable peer; skip it
+                if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    dropped_count_.fetch_add(send_count_ - done,
+                                             std::memory_order_relaxed);
+                    break;
+                }
+
+                dropped_count_.fetch_add(1, std::memory_order_relaxed);
+                ++done;
+            }
+
+            sent_count_.fetch_add(sent, std::memory_order_relaxed);
+            send_count_ = 0;
+        }
+    };
+
+    inline int DatagramSession::worker() const
+    {
+        return worker_->index();
+    }
+
+    inline bool DatagramSession::reply(const char* buff, int size) const
+    {
+        return worker_->queue(peer_, buff, size);
+    }
+
+    inline bool DatagramSession::send_to(const sockaddr_in& addr,
+                                         const char* buff,
+                                         int size) const
+    {
+        return worker_->queue(addr, buff, size);
+    }
+
+    inline bool DatagramSession::reply_segmented(const char* buff,
+                                                 int size,
+                                                 int segment_size) const
+    {
+        return worker_->send_segmented(peer_, buff, size, segment_size);
+    }
+
+    inline bool DatagramSession::send_segmented_to(const sockaddr_in& addr,
+                                                   const char* buff,
+                                                   int size,
+                                                   int segment_size) const
+    {
+        return worker_->send_segmented(addr, buff, size, segment_size);
+    }
+
+    //! @class DatagramServer
+    /*! UDP counterpart of BasicServer: each worker owns a socket bound to
+     *! the same port with SO_REUSEPORT, the kernel spreading senders across
+     *! them, and handles its datagrams in batches
+     */
+    class DatagramServer {
+        // Default value
+        static constexpr int kMaxWorkerCount = 1;
+    public:
+        /*! @brief Dtor.
+         */
+        ~DatagramServer()
+        {
+            for (const int sfd: sockets_) {
+                util::endpoint_close(sfd);
+            }
+        }
+
+        /*! @brief Ctor.
+         */
+        DatagramServer() = default;
+
+        /*! @brief Sets the callback called with each datagram received,
+         *! applied on next run
+         */
+        void bind_datagram_received_callback(const DatagramCallback& fn)
+        {
+            std::lock_guard<util::Mutex> l(run_access_lock_);
+            callback_ = std::make_shared<const DatagramCallback>(fn);
+        }
+
+        /*! @brief Sets the server tunables, applied on next run
+         */
+        void set_options(const DatagramOptions& options)
+        {
+            std::lock_guard<util::Mutex> l(run_access_lock_);
+            options_ = options;
+        }
+
+        /*! @brief Creates the first worker's socket, bound to port
+         */
+        bool bind(int port)
+        {
+            std::lock_guard<util::Mutex> l(run_access_lock_);
+            if (!sockets_.empty()) {
+                return false;
+            }
+
+            const int sfd = create_socket(port);
+            if (sfd == -1) {
+                return false;
+            }
+
+            port_ = port;
+            sockets_.push_back(sfd);
+            return true;
+        }
+
+        /*! @brief Enters run loop, serving the first worker on the calling
+         *! thread until stopped
+         */
+        void run(int worker_count = kMaxWorkerCount)
+        {
+            DatagramWorker* first = nullptr;
+            {
+                std::lock_guard<util::Mutex> l(run_access_lock_);
+                if (sockets_.empty() || !workers_.empty() || !callback_) {
+                    return;
+                }
+
+                // Sockets are kept across runs, and added as needed. Those
+                // kept take the options set since they were created.
+                for (const int sfd: sockets_) {
+                    configure_socket(sfd);
+                }
+
+                while (static_cast<int>(sockets_.size()) < worker_count) {
+                    const int sfd = create_socket(port_);
+                    if (sfd == -1) {
+                        break;
+                    }
+
+                    sockets_.push_back(sfd);
+                }
+
+                // Each socket must have a worker, or its share of senders
+                // would go unanswered
+                for (std::size_t i = 0; i != sockets_.size(); ++i) {
+                    workers_.push_back(std::make_unique<DatagramWorker>(
+                        static_cast<int>(i), sockets_[i], options_, callback_));
+                }
+
+                for (std::size_t i = 1; i != workers_.size(); ++i) {
+                    DatagramWorker* worker = workers_[i].get();
+                    threads_.emplace_back([worker] { worker->run(); });
+                }
+
+                first = workers_.front().get();
+            }
+
+            // Stopped, the other workers follow. A first worker that could
+            // not watch its socket stops them itself.
+            if (!first->run()) {
+                stop();
+            }
+
+            for (auto& thread: threads_) {
+                thread.join();
+            }
+
+            std::lock_guard<util::Mutex> l(run_access_lock_);
+            threads_.clear();
+            for (const auto& worker: workers_) {
+                add_metrics(*worker);
+            }
+
+            workers_.clear();
+        }
+
+        /*! @brief Stops run loop, which returns once all workers are done
+         */
+        void stop()
+        {
+            std::lock_guard<util::Mutex> l(run_access_lock_);
+            for (const auto& worker: workers_) {
+                worker->stop();
+            }
+        }
+
+        /*! @brief Datagrams handled so far, across all workers and runs
+         */
+        DatagramMetrics metrics() const
+        {
+            std::lock_guard<util::Mutex> l(run_access_lock_);
+            DatagramMetrics metrics = metrics_;
+            for (const auto& worker: workers_) {
+                metrics.received_count += worker->received_count();
+                metrics.sent_count += worker->sent_count();
+                metrics.dropped_count += worker->dropped_count();
+                metrics.truncated_count += worker->truncated_count();
+                metrics.coalesced_count += worker->coalesced_count();
+                metrics.segmented_count += worker->segmented_count();
+
+                const auto batch_sizes = worker->batch_sizes();
+                for (int i = 0; i != util::Histogram::kBucketCount; ++i) {
+                    metrics.batch_sizes.counts[i] += batch_sizes.counts[i];
+                }
+            }
+
+            return metrics;
+        }
+
+        // Non-copyable object
+        DatagramServer(const DatagramServer&) = delete;
+        DatagramServer& operator=(const DatagramServer&) = delete;
+    private:
+        // Primary access lock
+        mutable util::Mutex run_access_lock_{
+            "DatagramServer::run_access_lock_"};
+
+        // Server tunables
+        DatagramOptions options_;
+
+        // Callback called with each datagram received
+        std::shared_ptr<const DatagramCallback> callback_;
+
+        // Port the sockets are bound to
+        int port_ = 0;
+
+        // Receive buffer size the kernel gives new sockets (bytes), restored
+        // once the option is cleared
+        int default_receive_buffer_size_ = 0;
+
+        // One socket per worker
+        std::vector<int> sockets_;
+
+        // Workers of the current run, the first served by the run() caller
+        std::vector<std::unique_ptr<DatagramWorker>> workers_;
+        std::vector<std::thread> threads_;
+
+        // Datagrams handled by the workers of earlier runs
+        DatagramMetrics metrics_;
+
+        /* @helper */
+        int create_socket(int port)
+        {
+            const int sfd = util::endpoint_udp_server(port, true);
+            if (sfd == -1) {
+                return -1;
+            }
+
+            if (default_receive_buffer_size_ == 0) {
+                socklen_t size = sizeof(default_receive_buffer_size_);
+                ::getsockopt(sfd,
+                             SOL_SOCKET,
+                             SO_RCVBUF,
+                             &default_receive_buffer_size_,
+                             &size);
+            }
+
+            if (util::endpoint_unblock(sfd) == -1) {
+                util::endpoint_close(sfd);
+                return -1;
+            }
+
+            configure_socket(sfd);
+            return sfd;
+        }
+
+        /* @helper */
+        void configure_socket(int sfd) const
+        {
+            // The kernel doubles the size set, the default included
+            const int size = options_.receive_buffer_size > 0
+                                 ? options_.receive_buffer_size
+                                 : default_receive_buffer_size_ / 2;
+            if (size > 0) {
+                ::setsockopt(sfd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+            }
+
+            // Without kernel support datagrams simply arrive one by one
+            util::endpoint_set_udp_gro(sfd, options_.gro);
+        }
+
+        /* @helper */
+        void add_metrics(const DatagramWorker& worker)
+        {
+            metrics_.received_count += worker.received_count();
+            metrics_.sent_count += worker.sent_count();
+            metrics_.dropped_count += worker.dropped_count();
+            metrics_.truncated_count += worker.truncated_count();
+            metrics_.coalesced_count += worker.coalesced_count();
+            metrics_.segmented_count += worker.segmented_count();
+
+            const auto batch_sizes = worker.batch_sizes();
+            for (int i = 0; i != util::Histogram::kBucketCount; ++i) {
+                metrics_.batch_sizes.counts[i] += batch_sizes.counts[i];
+            }
+        }
+    };
+} // namespace fserv
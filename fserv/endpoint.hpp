@@ -5,7 +5,12 @@
 
 #include <arpa/inet.h>
 #include <cstdint>
+#include <cstring>
 #include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 namespace fserv::util {
@@ -71,9 +76,12 @@ namespace fserv::util {
     //! Creates a UDP server socket.
     //! @param port
     //!     Port number
+    //! @param reuse_port
+    //!     Whether other sockets may bind the same port (SO_REUSEPORT), the
+    //!     kernel spreading datagrams across them by source address
     //! @return
     //!     The socket file descriptor
-    inline int endpoint_udp_server(int port)
+    inline int endpoint_udp_server(int port, bool reuse_port = false)
     {
         struct sockaddr_in addr = {};
 
@@ -92,6 +100,12 @@ namespace fserv::util {
             return -1;
         }
 
+        if (reuse_port
+            && setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, &flags, sizeof(int))
+                   == -1) {
+            return ::close(sfd), -1;
+        }
+
         // bind to local socket
         if (bind(sfd,
                  reinterpret_cast<struct sockaddr*>(&addr),
@@ -117,6 +131,35 @@ namespace fserv::util {
         return ::recv(sfd, buff, bufflen, 0);
     }
 
+    //! Reads data from a socket into two buffers, filling the first before
+    //! the second.
+    //! @param sfd
+    //!     Socket file descriptor
+    //! @param buff1
+    //!     First data buffer
+    //! @param bufflen1
+    //!     First data buffer length
+    //! @param buff2
+    //!     Second data buffer
+    //! @param bufflen2
+    //!     Second data buffer length
+    //! @return
+    //!     Number of bytes read
+    inline int endpoint_readv(int sfd,
+                              void* buff1,
+                              int bufflen1,
+                              void* buff2,
+                              int bufflen2)
+    {
+        struct iovec iov[2] = {};
+        iov[0].iov_base = buff1;
+        iov[0].iov_len = bufflen1;
+        iov[1].iov_base = buff2;
+        iov[1].iov_len = bufflen2;
+
+        return ::readv(sfd, iov, 2);
+    }
+
     //! Reads out-of-band data from a socket.
     //! @param sfd
     //!     Socket file descriptor
@@ -140,7 +183,26 @@ namespace fserv::util {
     //!     Number of bytes written
     inline int endpoint_write(int sfd, const void* buff, int bufflen)
     {
-        return ::send(sfd, buff, bufflen, 0);
+        // Fail with EPIPE rather than raise SIGPIPE on a shut down socket
+        return ::send(sfd, buff, bufflen, MSG_NOSIGNAL);
+    }
+
+    //! Writes data from several buffers to socket, in order.
+    //! @param sfd
+    //!     Socket file descriptor
+    //! @param iov
+    //!     Data buffers
+    //! @param count
+    //!     Number of data buffers
+    //! @return
+    //!     Number of bytes written
+    inline int endpoint_writev(int sfd, const struct iovec* iov, int count)
+    {
+        struct msghdr msg = {};
+        msg.msg_iov = const_cast<struct iovec*>(iov);
+        msg.msg_iovlen = count;
+
+        return ::sendmsg(sfd, &msg, MSG_NOSIGNAL);
     }
 
     //! Writes data to socket.
@@ -207,6 +269,23 @@ namespace fserv::util {
                         sizeof(sockaddr_in));
     }
 
+    //! Makes an IPv4 socket address.
+    //! @param ipaddr
+    //!     Ip address, in dotted decimal notation
+    //! @param port
+    //!     Port number
+    //! @return
+    //!     The socket address
+    inline struct sockaddr_in endpoint_address(const char* const ipaddr,
+                                               int port)
+    {
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = ::htons(port);
+        addr.sin_addr.s_addr = ::inet_addr(ipaddr);
+        return addr;
+    }
+
     //! Connects to remote socket.
     //! @param sfd
     //!     Socket file descriptor
@@ -229,6 +308,21 @@ namespace fserv::util {
                          sizeof(struct sockaddr_in));
     }
 
+    //! Connects to remote socket.
+    //! @param sfd
+    //!     Socket file descriptor
+    //! @param addr
+    //!     Remote address
+    //! @return
+    //!     Result of the connect call, -1 with errno EINPROGRESS while a
+    //!     non-blocking connect completes
+    inline int endpoint_connect(int sfd, const struct sockaddr_in& addr)
+    {
+        return ::connect(sfd,
+                         reinterpret_cast<const struct sockaddr*>(&addr),
+                         sizeof(struct sockaddr_in));
+    }
+
     //! Sets a socket to non-blocking mode.
     //! @param sfd
     //!     Socket file descriptor
@@ -240,6 +334,143 @@ namespace fserv::util {
         return ::fcntl(sfd, F_SETFL, flags | O_NONBLOCK);
     }
 
+    //! Sets the minimum number of bytes queued on a socket before it is
+    //! reported readable.
+    //! @param sfd
+    //!     Socket file descriptor
+    //! @param size
+    //!     Low watermark (bytes)
+    //! @return
+    //!     Result of the setsockopt call
+    inline int endpoint_set_rcvlowat(int sfd, int size)
+    {
+        return ::setsockopt(sfd, SOL_SOCKET, SO_RCVLOWAT, &size, sizeof(int));
+    }
+
+    //! Sets the maximum number of unsent bytes queued on a socket before it
+    //! stops accepting writes and is no longer reported writable.
+    //! @param sfd
+    //!     Socket file descriptor
+    //! @param size
+    //!     Unsent low watermark (bytes)
+    //! @return
+    //!     Result of the setsockopt call
+    inline int endpoint_set_notsent_lowat(int sfd, int size)
+    {
+        return ::setsockopt(
+            sfd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &size, sizeof(int));
+    }
+
+    //! Lets the kernel hand a UDP socket several datagrams from the same
+    //! flow as one buffer (UDP_GRO), their size given by a UDP_GRO control
+    //! message.
+    //! @param sfd
+    //!     Socket file descriptor
+    //! @param enable
+    //!     Whether to coalesce datagrams
+    //! @return
+    //!     Result of the setsockopt call
+    inline int endpoint_set_udp_gro(int sfd, bool enable)
+    {
+        int flags = enable ? 1 : 0;
+        return ::setsockopt(sfd, SOL_UDP, UDP_GRO, &flags, sizeof(int));
+    }
+
+    //! Writes a buffer to socket as datagrams of segment_size bytes, the
+    //! last one possibly shorter, split by the kernel (UDP_SEGMENT).
+    //! @param sfd
+    //!     Socket file descriptor
+    //! @param addr
+    //!     Remote address
+    //! @param buff
+    //!     Data buffer
+    //! @param bufflen
+    //!     Data buffer length, at most 64 segments and 65507 bytes
+    //! @param segment_size
+    //!     Datagram size (bytes)
+    //! @return
+    //!     Number of bytes written
+    inline int endpoint_write_segmented(int sfd,
+                                        const struct sockaddr_in& addr,
+                                        const void* buff,
+                                        int bufflen,
+                                        int segment_size)
+    {
+        struct iovec iov = {};
+        iov.iov_base = const_cast<void*>(buff);
+        iov.iov_len = bufflen;
+
+        alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(std::uint16_t))]
+            = {};
+
+        struct msghdr msg = {};
+        msg.msg_name = const_cast<struct sockaddr_in*>(&addr);
+        msg.msg_namelen = sizeof(struct sockaddr_in);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+
+        const auto size = static_cast<std::uint16_t>(segment_size);
+        std::memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+
+        return ::sendmsg(sfd, &msg, MSG_DONTWAIT);
+    }
+
+    //! Creates a non-blocking pipe to splice between sockets through.
+    //! @param fds[out]
+    //!     Read and write ends
+    //! @param size
+    //!     Capacity (bytes), zero for the kernel default
+    //! @return
+    //!     Capacity of the pipe (bytes), which may differ from the one
+    //!     requested, or -1 on error
+    inline int endpoint_pipe(int fds[2], int size)
+    {
+        if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) == -1) {
+            return -1;
+        }
+
+        // Above the system limit, the default capacity is kept
+        if (size > 0) {
+            ::fcntl(fds[1], F_SETPIPE_SZ, size);
+        }
+
+        const int capacity = ::fcntl(fds[1], F_GETPIPE_SZ);
+        if (capacity == -1) {
+            ::close(fds[0]);
+            ::close(fds[1]);
+            fds[0] = fds[1] = -1;
+        }
+
+        return capacity;
+    }
+
+    //! Moves data between a socket and a pipe within the kernel, without
+    //! blocking on the pipe.
+    //! @param in
+    //!     Socket or pipe read end
+    //! @param out
+    //!     Pipe write end or socket
+    //! @param size
+    //!     Maximum number of bytes to move
+    //! @return
+    //!     Number of bytes moved, zero at the end of the input
+    inline int endpoint_splice(int in, int out, int size)
+    {
+        return static_cast<int>(::splice(in,
+                                         nullptr,
+                                         out,
+                                         nullptr,
+                                         size,
+                                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK));
+    }
+
     //! Closes a socket.
     //! @param sfd
     //!     Socket file descriptor
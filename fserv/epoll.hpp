@@ -3,10 +3,13 @@
 
 #pragma once
 
+#include "coarse_clock.hpp"
 #include "endpoint.hpp"
 #include <atomic>
+#include <cstdint>
 #include <stdexcept>
 #include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 namespace fserv::detail {
     //! Implements epoll_ctl().
@@ -46,6 +49,9 @@ namespace fserv {
             util::endpoint_close(epfd_);
             util::endpoint_close(selfpipe_[0]);
             util::endpoint_close(selfpipe_[1]);
+            if (timerfd_ != -1) {
+                util::endpoint_close(timerfd_);
+            }
         }
 
         //! Ctor.
@@ -116,6 +122,65 @@ namespace fserv {
             return detail::ctl(epfd_, EPOLL_CTL_MOD, sfd, flags, handler) == 0;
         }
 
+        //! Adds a timer, whose expiry calls timer_triggered() on the sink from
+        //! one worker at a time, until the timer is set again.
+        //! @return
+        //!     True if the timer is available, false otherwise
+        bool enable_timer()
+        {
+            if (timerfd_ != -1) {
+                return true;
+            }
+
+            timerfd_ = ::timerfd_create(CLOCK_MONOTONIC,
+                                        TFD_NONBLOCK | TFD_CLOEXEC);
+            if (timerfd_ == -1) {
+                return false;
+            }
+
+            if (detail::ctl(epfd_,
+                            EPOLL_CTL_ADD,
+                            timerfd_,
+                            EPOLLIN | EPOLLET | EPOLLONESHOT,
+                            &timerfd_)
+                == -1) {
+                util::endpoint_close(timerfd_);
+                timerfd_ = -1;
+                return false;
+            }
+
+            return true;
+        }
+
+        //! Sets the timer to expire after a delay, replacing any earlier
+        //! setting.
+        //! @param delay
+        //!     Delay (ms), negative to disarm
+        void set_timer(std::int64_t delay)
+        {
+            struct itimerspec spec = {};
+            if (delay >= 0) {
+                spec.it_value.tv_sec = delay / 1000;
+                spec.it_value.tv_nsec = (delay % 1000) * 1000000;
+                if (delay == 0) {
+                    // Zero would disarm the timer
+                    spec.it_value.tv_nsec = 1;
+                }
+            }
+
+            ::timerfd_settime(timerfd_, 0, &spec, nullptr);
+        }
+
+        //! Rearms timer notification once its expiry has been handled.
+        void rearm_timer()
+        {
+            detail::ctl(epfd_,
+                        EPOLL_CTL_MOD,
+                        timerfd_,
+                        EPOLLIN | EPOLLET | EPOLLONESHOT,
+                        &timerfd_);
+        }
+
         //! Waits on epoll instance.
         //! @param sink
         //!     Downstream event handler
@@ -150,6 +215,9 @@ namespace fserv {
         // Epoll parameter
         int epfd_ = -1;
 
+        // Timer descriptor, -1 until enabled
+        int timerfd_ = -1;
+
         // Epoll parameter
         int max_events_ = kDefaultMaxEvents;
 
@@ -179,6 +247,11 @@ namespace fserv {
                 break; // Encountered error
             }
 
+            // Timestamps taken while handling this batch read the cache
+            if (nevents > 0) {
+                util::CoarseClock::refresh();
+            }
+
             for (int i = 0; i != nevents; ++i) {
                 auto& event = events[i];
                 // If event is from control socket, trigger daisy-changed
@@ -200,6 +273,18 @@ namespace fserv {
                     break;
                 }
 
+                // Timer expired, acknowledge and let the sink handle it
+                if (event.data.ptr == &timerfd_) {
+                    if constexpr (requires { sink->timer_triggered(); }) {
+                        std::uint64_t expirations;
+                        [[maybe_unused]] auto n = ::read(
+                            timerfd_, &expirations, sizeof(expirations));
+                        sink->timer_triggered();
+                    }
+
+                    continue;
+                }
+
                 // Otherwise, have a regular socket, so handle the event
                 sink->trigger(
                     reinterpret_cast<HandlerType*>(events[i].data.ptr),
@@ -0,0 +1,579 @@
+/* framing.hpp -- v1.0
+   Splits client byte streams into complete messages */
+
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fserv {
+
+    //! @struct Frame
+    /*! Result of scanning a byte stream for its first message
+     */
+    struct Frame {
+        // Offset of the message payload from the start of the frame
+        int offset = 0;
+        // Size of the message payload
+        int size = 0;
+        // Total frame length, header and trailer included
+        // Zero if the frame is incomplete
+        int length = 0;
+        // Total frame length needed for the scan to make progress when the
+        // frame is incomplete, zero if unknown
+        int needed = 0;
+        // Leading bytes known to hold no end of frame when the frame is
+        // incomplete, which a scan of the same bytes, extended, may skip
+        int scanned = 0;
+    };
+
+    //! @concept Framer
+    /*! A framer scans the start of a byte stream for one complete message.
+     *! scan() returns false on a protocol violation, otherwise fills in the
+     *! frame, leaving its length at zero if more bytes are needed.
+     */
+    template <typename T>
+    concept Framer
+        = requires(const T& framer, const char* data, int size, Frame* frame) {
+              { framer.scan(data, size, frame) } -> std::convertible_to<bool>;
+          };
+
+    //! @concept ResumableFramer
+    /*! A framer that can resume a scan past the bytes a previous scan of the
+     *! same incomplete frame reported in Frame::scanned
+     */
+    template <typename T>
+    concept ResumableFramer
+        = Framer<T>
+          && requires(
+              const T& framer, const char* data, int size, Frame* frame) {
+                 {
+                     framer.scan(data, size, size, frame)
+                 } -> std::convertible_to<bool>;
+             };
+
+    //! @class AnyFramer
+    /*! Type-erased, shareable handle to a framer
+     */
+    class AnyFramer {
+    public:
+        //! Ctor.
+        //! Leaves the stream unframed.
+        AnyFramer() = default;
+
+        //! Ctor.
+        //! @param framer
+        //!     Framer, copied into shared storage
+        template <Framer FramerType>
+        AnyFramer(FramerType framer) // NOLINT
+            : framer_(std::make_shared<const FramerType>(std::move(framer)))
+            , scan_fn_([](const void* ptr,
+                          const char* data,
+                          int size,
+                          int from,
+                          Frame* frame) -> bool {
+                const auto* framer = static_cast<const FramerType*>(ptr);
+                if constexpr (ResumableFramer<FramerType>) {
+                    return framer->scan(data, size, from, frame);
+                } else {
+                    return framer->scan(data, size, frame);
+                }
+            })
+        {}
+
+        //! @return
+        //!     True if a framer is set
+        explicit operator bool() const
+        {
+            return scan_fn_ != nullptr;
+        }
+
+        //! Forwards to the wrapped framer.
+        bool scan(const char* data, int size, Frame* frame) const
+        {
+            return scan_fn_(framer_.get(), data, size, 0, frame);
+        }
+
+        //! Forwards to the wrapped framer, skipping the first bytes if it
+        //! can resume scans.
+        //! @param from
+        //!     Leading bytes known to hold no end of frame, as reported by a
+        //!     previous scan in Frame::scanned
+        bool scan(const char* data, int size, int from, Frame* frame) const
+        {
+            return scan_fn_(framer_.get(), data, size, from, frame);
+        }
+    private:
+        // Wrapped framer
+        std::shared_ptr<const void> framer_;
+        // Invokes scan() on the wrapped framer
+        bool (*scan_fn_)(const void*, const char*, int, int, Frame*) = nullptr;
+    };
+
+    //! @class LengthPrefixFramer
+    /*! Messages preceded by a fixed-size, big-endian payload length
+     */
+    class LengthPrefixFramer {
+    public:
+        //! Ctor.
+        //! @param header_size
+        //!     Size of the length prefix (1, 2, 4 or 8 bytes)
+        //! @param max_size
+        //!     Largest accepted payload size
+        explicit LengthPrefixFramer(int header_size = 4,
+                                    int max_size = kDefaultMaxSize)
+            : header_size_(header_size)
+            , max_size_(max_size)
+        {}
+
+        //! Scans for the first message.
+        bool scan(const char* data, int size, Frame* frame) const
+        {
+            *frame = Frame();
+            if (size < header_size_) {
+                frame->needed = header_size_;
+                return true;
+            }
+
+            std::uint64_t payload_size = 0;
+            for (int i = 0; i != header_size_; ++i) {
+                payload_size = (payload_size << 8)
+                               | static_cast<unsigned char>(data[i]);
+            }
+
+            if (payload_size > static_cast<std::uint64_t>(max_size_)) {
+                return false;
+            }
+
+            frame->offset = header_size_;
+            frame->size = static_cast<int>(payload_size);
+            frame->needed = header_size_ + frame->size;
+            if (size >= frame->needed) {
+                frame->length = frame->needed;
+            }
+
+            return true;
+        }
+    private:
+        static constexpr int kDefaultMaxSize = 16 * 1024 * 1024;
+
+        int header_size_ = 4;
+        int max_size_ = kDefaultMaxSize;
+    };
+
+    //! @class VarintFramer
+    /*! Messages preceded by a base-128 varint payload length, least
+     *! significant group first
+     */
+    class VarintFramer {
+    public:
+        //! Ctor.
+        //! @param max_size
+        //!     Largest accepted payload size
+        explicit VarintFramer(int max_size = kDefaultMaxSize)
+            : max_size_(max_size)
+        {}
+
+        //! Scans for the first message.
+        bool scan(const char* data, int size, Frame* frame) const
+        {
+            constexpr int kMaxHeaderSize = 5;
+
+            *frame = Frame();
+
+            std::uint64_t payload_size = 0;
+            for (int i = 0; i != kMaxHeaderSize; ++i) {
+                if (i == size) {
+                    frame->needed = size + 1;
+                    return true;
+                }
+
+                const auto byte = static_cast<unsigned char>(data[i]);
+                payload_size |= static_cast<std::uint64_t>(byte & 0x7f)
+                                << (7 * i);
+                if (payload_size > static_cast<std::uint64_t>(max_size_)) {
+                    return false;
+                }
+
+                if ((byte & 0x80) == 0) {
+                    frame->offset = i + 1;
+                    frame->size = static_cast<int>(payload_size);
+                    frame->needed = frame->offset + frame->size;
+                    if (size >= frame->needed) {
+                        frame->length = frame->needed;
+                    }
+
+                    return true;
+                }
+            }
+
+            // Length prefix overruns its maximum size
+            return false;
+        }
+    private:
+        static constexpr int kDefaultMaxSize = 16 * 1024 * 1024;
+
+        int max_size_ = kDefaultMaxSize;
+    };
+
+    //! @class DelimiterFramer
+    /*! Messages terminated by a delimiter sequence, which is stripped from
+     *! the delivered payload
+     */
+    class DelimiterFramer {
+    public:
+        //! Ctor.
+        //! @param delimiter
+        //!     Delimiter sequence, must not be empty
+        //! @param max_size
+        //!     Largest accepted payload size
+        explicit DelimiterFramer(std::string delimiter = "\n",
+                                 int max_size = kDefaultMaxSize)
+            : delimiter_(std::move(delimiter))
+            , max_size_(max_size)
+        {}
+
+        //! Scans for the first message.
+        bool scan(const char* data, int size, Frame* frame) const
+        {
+            return scan(data, size, 0, frame);
+        }
+
+        //! Scans for the first message, searching for the delimiter past the
+        //! bytes a previous scan of the same message left behind.
+        //! @param from
+        //!     Leading bytes known to hold no delimiter start
+        bool scan(const char* data, int size, int from, Frame* frame) const
+        {
+            *frame = Frame();
+
+            const int delimiter_size = static_cast<int>(delimiter_.size());
+            const char first = delimiter_[0];
+
+            for (int i = from; i + delimiter_size <= size; ++i) {
+                const void* ptr = std::memchr(data + i, first, size - i);
+                if (ptr == nullptr) {
+                    break;
+                }
+
+                i = static_cast<int>(static_cast<const char*>(ptr) - data);
+                if (i + delimiter_size > size) {
+                    break;
+                }
+
+                if (std::memcmp(data + i, delimiter_.data(), delimiter_size)
+                    == 0) {
+                    if (i > max_size_) {
+                        return false;
+                    }
+
+                    frame->size = i;
+                    frame->length = i + delimiter_size;
+                    frame->needed = frame->length;
+                    return true;
+                }
+            }
+
+            // A delimiter may still start in its length - 1 last bytes
+            frame->scanned = size - delimiter_size + 1 > from
+                                 ? size - delimiter_size + 1
+                                 : from;
+
+            // Delimiter not found, but buffered payload is already too big
+            return size <= max_size_ + delimiter_size;
+        }
+    private:
+        static constexpr int kDefaultMaxSize = 16 * 1024 * 1024;
+
+        std::string delimiter_;
+        int max_size_ = kDefaultMaxSize;
+    };
+
+    //! @class FrameAssembler
+    /*! Per-connection framing state. Complete messages are handed out in
+     *! place from the read buffer; only a message split across reads is
+     *! copied into the reassembly buffer.
+     */
+    class FrameAssembler {
+    public:
+        //! Feeds newly-read bytes.
+        //! @param framer
+        //!     Stream framer
+        //! @param data
+        //!     Read buffer
+        //! @param size
+        //!     Read buffer size
+        //! @param on_frame
+        //!     Called with each complete payload and its size; stops the feed
+        //!     by returning false, leaving the remaining bytes buffered
+        //! @return
+        //!     False on a protocol violation, true otherwise
+        template <typename CallbackType>
+        bool feed(const AnyFramer& framer,
+                  const char* data,
+                  int size,
+                  CallbackType&& on_frame)
+        {
+            Frame frame;
+            int copied = 0;
+
+            // Complete the message split across previous reads, scanning only
+            // the bytes appended since
+            while (!partial_.empty()) {
+                if (!framer.scan(
+                        partial_.data(), partial_size(), scanned_, &frame)) {
+                    return false;
+                }
+
+                if (frame.length != 0) {
+                    break;
+                }
+
+                scanned_ = frame.scanned;
+
+                if (size == 0) {
+                    return true;
+                }
+
+                // Copy no further than the end of the message, if known, so
+                // that later messages can be handed out in place
+                int n = size;
+                if (frame.needed > partial_size()
+                    && frame.needed - partial_size() < n) {
+                    n = frame.needed - partial_size();
+                }
+
+                partial_.insert(partial_.end(), data, data + n);
+                data += n;
+                size -= n;
+                copied += n;
+            }
+
+            if (!partial_.empty()) {
+                const int overshoot = partial_size() - frame.length;
+
+                // Bytes left buffered by a stopped feed may hold several
+                // messages, nothing having been copied since
+                if (overshoot > copied) {
+                    return feed_buffered(framer, data, size, on_frame);
+                }
+
+                // Leftover bytes copied alongside the message (unknown
+                // message length) are still in the read buffer
+                partial_.resize(frame.length);
+                data -= overshoot;
+                size += overshoot;
+
+                const bool proceed
+                    = on_frame(partial_.data() + frame.offset, frame.size);
+
+                // Keep the buffer for the next split message, unless it was
+                // grown by an unusually large one
+                partial_.clear();
+                scanned_ = 0;
+                if (partial_.capacity() > kMaxRetainedSize) {
+                    std::vector<char>().swap(partial_);
+                }
+
+                if (!proceed) {
+                    partial_.assign(data, data + size);
+                    return true;
+                }
+            }
+
+            return feed_in_place(framer, data, size, on_frame);
+        }
+
+        //! @return
+        //!     True if part of a message is buffered
+        bool has_partial() const
+        {
+            return !partial_.empty();
+        }
+
+        //! @return
+        //!     Number of buffered bytes
+        int buffered_size() const
+        {
+            return partial_size();
+        }
+
+        //! @param framer
+        //!     Stream framer
+        //! @return
+        //!     Number of bytes still needed to complete the buffered
+        //!     message, zero if none is buffered or its length is unknown
+        int remaining(const AnyFramer& framer) const
+        {
+            return remaining(framer, partial_.data(), partial_size(), scanned_);
+        }
+
+        //! @param framer
+        //!     Stream framer
+        //! @param data
+        //!     Buffered bytes of an incomplete message
+        //! @param size
+        //!     Number of buffered bytes
+        //! @param from
+        //!     Leading bytes known to hold no end of frame
+        //! @return
+        //!     Number of bytes still needed to complete the message, zero if
+        //!     none is buffered or its length is unknown
+        static int remaining(const AnyFramer& framer,
+                             const char* data,
+                             int size,
+                             int from = 0)
+        {
+            Frame frame;
+            if (size == 0 || !framer.scan(data, size, from, &frame)) {
+                return 0;
+            }
+
+            return frame.needed > size ? frame.needed - size : 0;
+        }
+
+        //! Moves buffered bytes out, from the front.
+        //! @param buff
+        //!     Destination buffer
+        //! @param size
+        //!     Destination buffer size
+        //! @return
+        //!     Number of bytes moved
+        int take(char* buff, int size)
+        {
+            const int n = size < partial_size() ? size : partial_size();
+            std::memcpy(buff, partial_.data(), n);
+            partial_.erase(partial_.begin(), partial_.begin() + n);
+            scanned_ = scanned_ > n ? scanned_ - n : 0;
+            return n;
+        }
+
+        //! Hands out the complete messages at the start of a contiguous span,
+        //! leaving any trailing partial message to the caller.
+        //! @param framer
+        //!     Stream framer
+        //! @param data
+        //!     Contiguous span of buffered stream bytes
+        //! @param size
+        //!     Span size
+        //! @param on_frame
+        //!     Called with each complete payload and its size; stops the scan
+        //!     by returning false
+        //! @param proceed[out]
+        //!     Set to false if the scan was stopped by on_frame
+        //! @param scanned[in,out]
+        //!     Leading bytes of the span known to hold no end of frame, then
+        //!     the same for the trailing partial message left
+        //! @return
+        //!     Number of bytes consumed, -1 on a protocol violation
+        template <typename CallbackType>
+        static int consume(const AnyFramer& framer,
+                           const char* data,
+                           int size,
+                           CallbackType&& on_frame,
+                           bool* proceed,
+                           int* scanned)
+        {
+            Frame frame;
+
+            int from = *scanned;
+            *scanned = 0;
+
+            int consumed = 0;
+            while (consumed != size) {
+                if (!framer.scan(
+                        data + consumed, size - consumed, from, &frame)) {
+                    return -1;
+                }
+
+                if (frame.length == 0) {
+                    *scanned = frame.scanned;
+                    break;
+                }
+
+                from = 0;
+
+                const char* payload = data + consumed + frame.offset;
+                consumed += frame.length;
+
+                if (!on_frame(payload, frame.size)) {
+                    *proceed = false;
+                    break;
+                }
+            }
+
+            return consumed;
+        }
+    private:
+        // Largest reassembly buffer kept between split messages
+        static constexpr std::size_t kMaxRetainedSize = 64 * 1024;
+
+        // Holds a message split across reads
+        std::vector<char> partial_;
+        // Leading bytes of partial_ known to hold no end of frame
+        int scanned_ = 0;
+
+        /* @helper */
+        int partial_size() const
+        {
+            return static_cast<int>(partial_.size());
+        }
+
+        /* @helper */
+        template <typename CallbackType>
+        bool feed_in_place(const AnyFramer& framer,
+                           const char* data,
+                           int size,
+                           CallbackType&& on_frame)
+        {
+            bool proceed = true;
+            int scanned = 0;
+
+            const int consumed
+                = consume(framer, data, size, on_frame, &proceed, &scanned);
+            if (consumed == -1) {
+                return false;
+            }
+
+            if (consumed != size) {
+                partial_.assign(data + consumed, data + size);
+                scanned_ = scanned;
+            }
+
+            return true;
+        }
+
+        /* @helper */
+        template <typename CallbackType>
+        bool feed_buffered(const AnyFramer& framer,
+                           const char* data,
+                           int size,
+                           CallbackType&& on_frame)
+        {
+            bool proceed = true;
+
+            const int consumed = consume(framer,
+                                         partial_.data(),
+                                         partial_size(),
+                                         on_frame,
+                                         &proceed,
+                                         &scanned_);
+            if (consumed == -1) {
+                return false;
+            }
+
+            partial_.erase(partial_.begin(), partial_.begin() + consumed);
+            if (!proceed) {
+                partial_.insert(partial_.end(), data, data + size);
+                return true;
+            }
+
+            return feed(framer, data, size, on_frame);
+        }
+    };
+} // namespace fserv
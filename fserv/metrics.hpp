@@ -0,0 +1,329 @@
+/* metrics.hpp -- v1.0
+   Histograms and telemetry records published by the pools */
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fserv::util {
+
+    //! @class Histogram
+    /*! Counts of values in power-of-two buckets. Recording is a single
+     *! relaxed increment, safe from any thread.
+     */
+    class Histogram {
+    public:
+        // Bucket 0 holds zero, bucket i values in [2^(i-1), 2^i)
+        static constexpr int kBucketCount = 65;
+
+        //! @struct Snapshot
+        /*! Bucket counts, read at one point in time
+         */
+        struct Snapshot {
+            std::uint64_t counts[kBucketCount] = {};
+
+            //! @return
+            //!     Number of recorded values
+            std::uint64_t count() const
+            {
+                std::uint64_t total = 0;
+                for (const auto n: counts) {
+                    total += n;
+                }
+
+                return total;
+            }
+
+            //! @param fraction
+            //!     Fraction of values, in [0, 1]
+            //! @return
+            //!     Upper bound of the bucket holding the value below which
+            //!     the fraction of values lie, zero if none was recorded
+            std::uint64_t percentile(double fraction) const
+            {
+                const std::uint64_t total = count();
+                if (total == 0) {
+                    return 0;
+                }
+
+                auto rank = static_cast<std::uint64_t>(fraction * total);
+                if (rank >= total) {
+                    rank = total - 1;
+                }
+
+                std::uint64_t seen = 0;
+                for (int i = 0; i != kBucketCount; ++i) {
+                    seen += counts[i];
+                    if (seen > rank) {
+                        return upper_bound(i);
+                    }
+                }
+
+                return upper_bound(kBucketCount - 1);
+            }
+        };
+
+        //! Records a value.
+        //! @param value
+        //!     Value to record
+        void record(std::uint64_t value)
+        {
+            buckets_[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        //! @return
+        //!     Current bucket counts
+        Snapshot snapshot() const
+        {
+            Snapshot snapshot;
+            for (int i = 0; i != kBucketCount; ++i) {
+                snapshot.counts[i]
+                    = buckets_[i].load(std::memory_order_relaxed);
+            }
+
+            return snapshot;
+        }
+
+        //! @param value
+        //!     Value
+        //! @return
+        //!     Bucket the value is counted in
+        static int bucket_of(std::uint64_t value)
+        {
+            return kBucketCount - 1 - std::countl_zero(value);
+        }
+
+        //! @param bucket
+        //!     Bucket
+        //! @return
+        //!     Largest value counted in the bucket
+        static std::uint64_t upper_bound(int bucket)
+        {
+            return bucket == kBucketCount - 1
+                       ? ~std::uint64_t(0)
+                       : (std::uint64_t(1) << bucket) - 1;
+        }
+    private:
+        std::atomic<std::uint64_t> buckets_[kBucketCount] = {};
+    };
+
+    //! Reads the network namespace's listener drop counters from
+    //! /proc/net/netstat.
+    //! @param overflows[out]
+    //!     Connections dropped for a full accept queue (ListenOverflows)
+    //! @param drops[out]
+    //!     Connection requests dropped by listeners (ListenDrops)
+    //! @return
+    //!     True if both counters were read, false otherwise
+    inline bool read_listen_counters(std::uint64_t* overflows,
+                                     std::uint64_t* drops)
+    {
+        std::ifstream file("/proc/net/netstat");
+
+        // Counters come as a line of names followed by a line of values,
+        // each starting with the same prefix
+        std::string names;
+        std::string values;
+        while (std::getline(file, names) && std::getline(file, values)) {
+            if (names.rfind("TcpExt:", 0) != 0) {
+                continue;
+            }
+
+            std::istringstream name_stream(names);
+            std::istringstream value_stream(values);
+            std::string name;
+            std::string value;
+            int found = 0;
+            while (name_stream >> name && value_stream >> value) {
+                if (name == "ListenOverflows") {
+                    *overflows = std::stoull(value);
+                    ++found;
+                } else if (name == "ListenDrops") {
+                    *drops = std::stoull(value);
+                    ++found;
+                }
+            }
+
+            return found == 2;
+        }
+
+        return false;
+    }
+} // namespace fserv::util
+
+namespace fserv {
+
+    //! @struct TcpSample
+    /*! Connection state read from TCP_INFO
+     */
+    struct TcpSample {
+        // Smoothed round-trip time (us)
+        std::uint32_t rtt = 0;
+        // Round-trip time variance (us)
+        std::uint32_t rtt_var = 0;
+        // Congestion window (segments)
+        std::uint32_t cwnd = 0;
+        // Segments retransmitted over the connection's life
+        std::uint32_t retransmits = 0;
+        // Bytes sent but not yet acknowledged, from the unacknowledged
+        // segment count and the sender MSS
+        std::uint32_t unacked = 0;
+        // Time of the sample (ms), zero if never sampled
+        std::int64_t sampled_at = 0;
+    };
+
+    //! @struct TcpMetrics
+    /*! Distributions of the TCP_INFO samples taken across all connections
+     */
+    struct TcpMetrics {
+        // Number of samples taken
+        std::uint64_t sample_count = 0;
+        // Smoothed round-trip time (us)
+        util::Histogram::Snapshot rtt;
+        // Congestion window (segments)
+        util::Histogram::Snapshot cwnd;
+        // Segments retransmitted since the connection's previous sample
+        util::Histogram::Snapshot retransmits;
+        // Bytes sent but not yet acknowledged
+        util::Histogram::Snapshot unacked;
+    };
+
+    //! @struct ListenerBacklog
+    /*! Accept queue of a listener socket, read from TCP_INFO
+     */
+    struct ListenerBacklog {
+        // Listener uuid
+        int uuid = 0;
+        // Connections established but not yet accepted
+        std::uint32_t queued = 0;
+        // Maximum number of connections queued, the listen() backlog
+        std::uint32_t limit = 0;
+    };
+
+    //! @struct ListenerMetrics
+    /*! Health of the listener sockets
+     */
+    struct ListenerMetrics {
+        // Number of connections accepted
+        std::uint64_t accept_count = 0;
+        // Connections accepted per listener wakeup
+        util::Histogram::Snapshot accepts_per_wakeup;
+        // Connections dropped for a full accept queue since the pool
+        // started, from /proc/net/netstat, counted across the network
+        // namespace rather than per listener
+        std::uint64_t listen_overflows = 0;
+        // Connection requests dropped by listeners for any reason since the
+        // pool started, overflows included, likewise
+        std::uint64_t listen_drops = 0;
+        // Accept queue of each listener, as of the last check
+        std::vector<ListenerBacklog> backlogs;
+        // Time of the last check (ms), zero if none was made
+        std::int64_t checked_at = 0;
+    };
+
+    //! @struct LockSiteMetrics
+    /*! Contention of the mutexes declared at one site, recorded when built
+     *! with FSERV_PROFILE_LOCKS
+     */
+    struct LockSiteMetrics {
+        // Site name, such as "ClientPool::timers_lock_"
+        const char* name = nullptr;
+        // Number of times the mutexes were locked
+        std::uint64_t acquisitions = 0;
+        // Number of times a lock had to wait for another holder
+        std::uint64_t contentions = 0;
+        // Total time spent waiting for the mutexes (ns)
+        std::uint64_t wait_time = 0;
+        // Longest single wait (ns)
+        std::uint64_t max_wait_time = 0;
+        // Total time the mutexes were held (ns)
+        std::uint64_t hold_time = 0;
+    };
+
+    //! @struct StallReport
+    /*! Worker found serving one client for longer than the stall threshold
+     */
+    struct StallReport {
+        // Worker index
+        int worker = 0;
+        // Uuid of the client being served
+        int uuid = -1;
+        // Time spent serving the client so far (ms)
+        std::int64_t duration = 0;
+        // Return addresses of the worker's stack, captured shortly after the
+        // stall was found, empty if not captured
+        std::vector<void*> frames;
+    };
+
+    //! @struct StallMetrics
+    /*! Workers found serving one client for longer than the stall threshold
+     */
+    struct StallMetrics {
+        // Number of stalls found
+        std::uint64_t stall_count = 0;
+        // Time spent serving the client (ms), recorded once a stalled worker
+        // moves on
+        util::Histogram::Snapshot durations;
+    };
+
+    //! @struct DatagramMetrics
+    /*! Datagrams handled by a datagram server
+     */
+    struct DatagramMetrics {
+        // Number of datagrams received
+        std::uint64_t received_count = 0;
+        // Number of datagrams sent
+        std::uint64_t sent_count = 0;
+        // Number of datagrams the sockets did not take, their send buffer
+        // being full or the destination unreachable
+        std::uint64_t dropped_count = 0;
+        // Number of datagrams received longer than max_datagram_size and
+        // truncated, or dropped as their coalescing details were cut
+        std::uint64_t truncated_count = 0;
+        // Number of buffers received holding several datagrams (UDP_GRO)
+        std::uint64_t coalesced_count = 0;
+        // Number of buffers sent as several datagrams (UDP_SEGMENT)
+        std::uint64_t segmented_count = 0;
+        // Datagrams received per recvmmsg()
+        util::Histogram::Snapshot batch_sizes;
+    };
+
+    //! @struct UpstreamMetrics
+    /*! Use of the connections of an upstream pool
+     */
+    struct UpstreamMetrics {
+        // Number of leases granted
+        std::uint64_t lease_count = 0;
+        // Number of leases served by an open connection, without connecting
+        std::uint64_t reuse_count = 0;
+        // Number of leases refused, all of the worker's connections being
+        // in use
+        std::uint64_t exhausted_count = 0;
+        // Number of connections established
+        std::uint64_t connect_count = 0;
+        // Number of connects that failed
+        std::uint64_t connect_failure_count = 0;
+        // Number of idle connections closed by health checks, found closed
+        // by the peer or idle for too long
+        std::uint64_t health_close_count = 0;
+    };
+
+    //! @struct RelayMetrics
+    /*! Relays spliced between clients and their outbound connections
+     */
+    struct RelayMetrics {
+        // Number of relays started
+        std::uint64_t relay_count = 0;
+        // Number of relays ended by an error, a reset, a timeout or a failed
+        // connect rather than by both sides closing
+        std::uint64_t failure_count = 0;
+        // Number of bytes relayed, both ways
+        std::uint64_t relayed_bytes = 0;
+    };
+} // namespace fserv
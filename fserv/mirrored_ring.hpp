@@ -0,0 +1,141 @@
+/* mirrored_ring.hpp -- v1.0
+   Byte ring buffer mapped twice in a row in virtual memory */
+
+#pragma once
+
+#include "memory_util.hpp"
+#include <cstdint>
+#include <initializer_list>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace fserv::util {
+
+    //! @struct MirroredRing
+    /*! Ring of bytes whose pages are mapped twice, back to back, so that
+     *! any span of up to capacity bytes starting inside the ring can be
+     *! accessed contiguously, wrap-around included
+     */
+    struct MirroredRing {
+        char* ptr_to_mem = nullptr;
+        int capacity = 0;
+        // Total bytes consumed
+        std::uint64_t head = 0;
+        // Total bytes committed
+        std::uint64_t tail = 0;
+    };
+
+    /*! @brief Checks if memory is allocated.
+     */
+    inline bool is_allocated(const MirroredRing& ring)
+    {
+        return ring.ptr_to_mem != nullptr;
+    }
+
+    /*! @brief Initializes passed ring to given size, padded to page
+     *!        boundary.
+     */
+    inline bool init(MirroredRing& ring, int size_hint)
+    {
+        if (is_allocated(ring)) {
+            return true;
+        }
+
+        const std::size_t size = padd_to_page_boundary(size_hint);
+
+        int fd = ::memfd_create("fserv-ring", MFD_CLOEXEC);
+        if (fd == -1) {
+            return false;
+        }
+
+        if (::ftruncate(fd, size) == -1) {
+            return ::close(fd), false;
+        }
+
+        // Reserve twice the size, then map the same pages into both halves
+        void* mem = ::mmap(
+            nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            return ::close(fd), false;
+        }
+
+        char* base = static_cast<char*>(mem);
+        for (char* half: {base, base + size}) {
+            if (::mmap(half,
+                       size,
+                       PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_FIXED,
+                       fd,
+                       0)
+                == MAP_FAILED) {
+                ::munmap(mem, 2 * size);
+                return ::close(fd), false;
+            }
+        }
+
+        // Mappings hold their own reference
+        ::close(fd);
+
+        ring.ptr_to_mem = base;
+        ring.capacity = static_cast<int>(size);
+        ring.head = 0;
+        ring.tail = 0;
+
+        return true;
+    }
+
+    /*! @brief Destroys ring.
+     */
+    inline void destroy(MirroredRing& ring)
+    {
+        if (is_allocated(ring)) {
+            ::munmap(ring.ptr_to_mem, 2 * std::size_t(ring.capacity));
+            ring = MirroredRing();
+        }
+    }
+
+    /*! @brief Returns the number of committed, unconsumed bytes.
+     */
+    inline int readable_size(const MirroredRing& ring)
+    {
+        return static_cast<int>(ring.tail - ring.head);
+    }
+
+    /*! @brief Returns the start of the committed, unconsumed bytes.
+     */
+    inline char* read_ptr(const MirroredRing& ring)
+    {
+        return ring.ptr_to_mem + ring.head % ring.capacity;
+    }
+
+    /*! @brief Returns the number of bytes that can be written.
+     */
+    inline int writable_size(const MirroredRing& ring)
+    {
+        return ring.capacity - readable_size(ring);
+    }
+
+    /*! @brief Returns the start of the writable bytes.
+     */
+    inline char* write_ptr(const MirroredRing& ring)
+    {
+        return ring.ptr_to_mem + ring.tail % ring.capacity;
+    }
+
+    /*! @brief Commits bytes written at write_ptr().
+     */
+    inline void commit(MirroredRing& ring, int size)
+    {
+        ring.tail += size;
+    }
+
+    /*! @brief Consumes bytes from read_ptr().
+     */
+    inline void consume(MirroredRing& ring, int size)
+    {
+        ring.head += size;
+        if (ring.head == ring.tail) {
+            ring.head = ring.tail = 0;
+        }
+    }
+} // namespace fserv::util
@@ -0,0 +1,227 @@
+/* mutex.hpp -- v1.0
+   Mutex that records contention per declaration site when built with
+   FSERV_PROFILE_LOCKS */
+
+#pragma once
+
+#include "metrics.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace fserv::util {
+
+    //! @class LockSites
+    /*! Contention recorded for each mutex declaration site. Mutexes sharing
+     *! a site name, such as the same member of several objects, are counted
+     *! together.
+     */
+    class LockSites {
+    public:
+        // Maximum number of sites recorded
+        static constexpr int kMaxSites = 64;
+
+        //! @struct Site
+        /*! Counters of one site, updated with relaxed atomics
+         */
+        struct Site {
+            std::atomic<const char*> name = nullptr;
+            std::atomic<std::uint64_t> acquisitions = 0;
+            std::atomic<std::uint64_t> contentions = 0;
+            std::atomic<std::uint64_t> wait_time = 0;
+            std::atomic<std::uint64_t> max_wait_time = 0;
+            std::atomic<std::uint64_t> hold_time = 0;
+        };
+
+        //! @param name
+        //!     Site name
+        //! @return
+        //!     Counters of the site, registered on first use, null if all
+        //!     sites are taken
+        static Site* find(const char* name)
+        {
+            for (auto& site: sites()) {
+                const char* current = site.name.load(std::memory_order_acquire);
+                if (current == nullptr
+                    && site.name.compare_exchange_strong(
+                        current, name, std::memory_order_acq_rel)) {
+                    return &site;
+                }
+
+                if (std::strcmp(current, name) == 0) {
+                    return &site;
+                }
+            }
+
+            return nullptr;
+        }
+
+        //! @return
+        //!     Counters of every site recorded so far
+        static std::vector<LockSiteMetrics> snapshot()
+        {
+            std::vector<LockSiteMetrics> metrics;
+            for (const auto& site: sites()) {
+                const char* name = site.name.load(std::memory_order_acquire);
+                if (name == nullptr) {
+                    break;
+                }
+
+                constexpr auto kRelaxed = std::memory_order_relaxed;
+                LockSiteMetrics entry;
+                entry.name = name;
+                entry.acquisitions = site.acquisitions.load(kRelaxed);
+                entry.contentions = site.contentions.load(kRelaxed);
+                entry.wait_time = site.wait_time.load(kRelaxed);
+                entry.max_wait_time = site.max_wait_time.load(kRelaxed);
+                entry.hold_time = site.hold_time.load(kRelaxed);
+                metrics.push_back(entry);
+            }
+
+            return metrics;
+        }
+    private:
+        /* @helper */
+        static Site (&sites())[kMaxSites]
+        {
+            static Site sites[kMaxSites];
+            return sites;
+        }
+    };
+
+#ifdef FSERV_PROFILE_LOCKS
+    //! @class Mutex
+    /*! std::mutex recording its wait time, hold time and contention count
+     *! under its site
+     */
+    class Mutex {
+    public:
+        //! Ctor.
+        //! @param site
+        //!     Site name, a string literal
+        explicit Mutex(const char* site)
+            : site_(LockSites::find(site))
+        {}
+
+        //! Locks the mutex, waiting for the current holder if any.
+        void lock()
+        {
+            if (mutex_.try_lock()) {
+                acquired_at_ = now_ns();
+            } else {
+                const std::uint64_t start = now_ns();
+                mutex_.lock();
+                acquired_at_ = now_ns();
+                record_wait(acquired_at_ - start);
+            }
+
+            if (site_) {
+                site_->acquisitions.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        //! @return
+        //!     True if the mutex was locked without waiting
+        bool try_lock()
+        {
+            if (!mutex_.try_lock()) {
+                return false;
+            }
+
+            acquired_at_ = now_ns();
+            if (site_) {
+                site_->acquisitions.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            return true;
+        }
+
+        //! Unlocks the mutex.
+        void unlock()
+        {
+            const std::uint64_t held = now_ns() - acquired_at_;
+            mutex_.unlock();
+            if (site_) {
+                site_->hold_time.fetch_add(held, std::memory_order_relaxed);
+            }
+        }
+
+        // Non-copyable object
+        Mutex(const Mutex&) = delete;
+        Mutex& operator=(const Mutex&) = delete;
+    private:
+        std::mutex mutex_;
+        // Counters of the declaration site, null if not recorded
+        LockSites::Site* site_ = nullptr;
+        // Time the holder locked the mutex (ns), written under the lock
+        std::uint64_t acquired_at_ = 0;
+
+        /* @helper */
+        static std::uint64_t now_ns()
+        {
+            return static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                    .count());
+        }
+
+        /* @helper */
+        void record_wait(std::uint64_t wait)
+        {
+            if (!site_) {
+                return;
+            }
+
+            site_->contentions.fetch_add(1, std::memory_order_relaxed);
+            site_->wait_time.fetch_add(wait, std::memory_order_relaxed);
+
+            std::uint64_t max = site_->max_wait_time.load(
+                std::memory_order_relaxed);
+            while (wait > max
+                   && !site_->max_wait_time.compare_exchange_weak(
+                       max, wait, std::memory_order_relaxed)) {
+            }
+        }
+    };
+#else
+    //! @class Mutex
+    /*! std::mutex, named after its declaration site for profiled builds,
+     *! see FSERV_PROFILE_LOCKS
+     */
+    class Mutex {
+    public:
+        //! Ctor.
+        //! @param site
+        //!     Site name, a string literal
+        explicit Mutex(const char*) {}
+
+        //! Locks the mutex, waiting for the current holder if any.
+        void lock()
+        {
+            mutex_.lock();
+        }
+
+        //! @return
+        //!     True if the mutex was locked without waiting
+        bool try_lock()
+        {
+            return mutex_.try_lock();
+        }
+
+        //! Unlocks the mutex.
+        void unlock()
+        {
+            mutex_.unlock();
+        }
+
+        // Non-copyable object
+        Mutex(const Mutex&) = delete;
+        Mutex& operator=(const Mutex&) = delete;
+    private:
+        std::mutex mutex_;
+    };
+#endif
+} // namespace fserv::util
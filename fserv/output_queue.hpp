@@ -0,0 +1,245 @@
+/* output_queue.hpp -- v1.0
+   Per-connection queue of messages waiting to be sent */
+
+#pragma once
+
+#include <cstddef>
+#include <sys/uio.h>
+#include <vector>
+
+namespace fserv::util {
+
+    //! @class OutputQueue
+    /*! Messages written to a connection but not yet taken by the socket.
+     *! Urgent and bulk messages are copied into two byte buffers, each
+     *! indexed by message size, so that messages not yet started can still
+     *! be reordered or dropped. The buffers keep their capacity, so queueing
+     *! allocates only while the backlog grows.
+     */
+    class OutputQueue {
+    public:
+        //! Most vector entries needed to describe the queued bytes: the
+        //! rest of the message being sent, then the urgent messages, then
+        //! the bulk ones
+        static constexpr int kMaxSpans = 3;
+
+        //! Queues a message behind all others.
+        //! @param data
+        //!     Message bytes
+        //! @param size
+        //!     Message size
+        //! @param sent
+        //!     Number of leading bytes already sent, only if the queue is
+        //!     empty
+        void push_back(const char* data, int size, int sent = 0)
+        {
+            bulk_.push(data, size, sent);
+        }
+
+        //! Queues a message ahead of all messages not yet started, behind
+        //! earlier urgent ones.
+        //! @param data
+        //!     Message bytes
+        //! @param size
+        //!     Message size
+        void push_urgent(const char* data, int size)
+        {
+            urgent_.push(data, size, 0);
+        }
+
+        //! Drops all messages not yet started.
+        //! @return
+        //!     Number of bytes dropped
+        int discard()
+        {
+            return urgent_.discard() + bulk_.discard();
+        }
+
+        //! @return
+        //!     True if no bytes are queued
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        //! @return
+        //!     Number of queued bytes
+        int size() const
+        {
+            return urgent_.size() + bulk_.size();
+        }
+
+        //! Describes the queued bytes, from the front.
+        //! @param iov
+        //!     Vector to fill in
+        //! @param max_count
+        //!     Vector capacity
+        //! @return
+        //!     Number of vector entries filled in
+        int gather(struct iovec* iov, int max_count) const
+        {
+            int count = 0;
+            const auto add = [&](const char* data, int size) {
+                if (size != 0 && count != max_count) {
+                    iov[count].iov_base = const_cast<char*>(data);
+                    iov[count].iov_len = size;
+                    ++count;
+                }
+            };
+
+            // Only one message can be part sent, and it goes out first
+            const int started = bulk_.started() ? bulk_.front_size() : 0;
+            add(bulk_.data(), started);
+            add(urgent_.data(), urgent_.size());
+            add(bulk_.data() + started, bulk_.size() - started);
+
+            return count;
+        }
+
+        //! Removes sent bytes from the front.
+        //! @param size
+        //!     Number of bytes sent
+        void consume(int size)
+        {
+            if (bulk_.started()) {
+                const int n = bulk_.front_size();
+                if (size < n) {
+                    bulk_.consume(size);
+                    return;
+                }
+
+                bulk_.consume(n);
+                size -= n;
+            }
+
+            const int n = size < urgent_.size() ? size : urgent_.size();
+            urgent_.consume(n);
+            bulk_.consume(size - n);
+        }
+    private:
+        //! @class Lane
+        /*! Messages sent in the order they were queued
+         */
+        class Lane {
+        public:
+            //! Appends a message.
+            void push(const char* data, int size, int sent)
+            {
+                bytes_.insert(bytes_.end(), data + sent, data + size);
+                sizes_.push_back(size);
+                if (sent != 0) {
+                    front_sent_ = sent;
+                }
+            }
+
+            //! Drops all messages but the one being sent.
+            //! @return
+            //!     Number of bytes dropped
+            int discard()
+            {
+                const int dropped = size() - (started() ? front_size() : 0);
+                if (!started()) {
+                    reset();
+                    return dropped;
+                }
+
+                bytes_.resize(head_ + front_size());
+                sizes_.resize(first_ + 1);
+                return dropped;
+            }
+
+            //! Removes sent bytes from the front.
+            void consume(int size)
+            {
+                head_ += size;
+                if (head_ == static_cast<int>(bytes_.size())) {
+                    reset();
+                    return;
+                }
+
+                size += front_sent_;
+                while (size >= sizes_[first_]) {
+                    size -= sizes_[first_++];
+                }
+
+                front_sent_ = size;
+
+                // Move the unsent bytes down once most of the buffer has
+                // been sent, so that a lane never emptied stays bounded
+                if (head_ >= kMinCompactSize
+                    && head_ > static_cast<int>(bytes_.size()) / 2) {
+                    bytes_.erase(bytes_.begin(), bytes_.begin() + head_);
+                    sizes_.erase(sizes_.begin(), sizes_.begin() + first_);
+                    head_ = 0;
+                    first_ = 0;
+                }
+            }
+
+            //! @return
+            //!     True if the front message is part sent
+            bool started() const
+            {
+                return front_sent_ != 0;
+            }
+
+            //! @return
+            //!     Number of bytes of the front message not yet sent
+            int front_size() const
+            {
+                return sizes_[first_] - front_sent_;
+            }
+
+            //! @return
+            //!     Start of the bytes not yet sent
+            const char* data() const
+            {
+                return bytes_.data() + head_;
+            }
+
+            //! @return
+            //!     Number of bytes not yet sent
+            int size() const
+            {
+                return static_cast<int>(bytes_.size()) - head_;
+            }
+        private:
+            // Sent bytes moved out once at least that many lead the buffer
+            static constexpr int kMinCompactSize = 64 * 1024;
+            // Largest buffer capacity kept once the lane empties
+            static constexpr std::size_t kMaxRetainedSize = 1024 * 1024;
+
+            // Queued bytes, those before head_ already sent
+            std::vector<char> bytes_;
+            // Message sizes, those before first_ already sent
+            std::vector<int> sizes_;
+            // Number of leading bytes sent
+            int head_ = 0;
+            // Index of the message being sent
+            int first_ = 0;
+            // Number of bytes of the front message already sent
+            int front_sent_ = 0;
+
+            /* @helper */
+            void reset()
+            {
+                bytes_.clear();
+                sizes_.clear();
+                head_ = 0;
+                first_ = 0;
+                front_sent_ = 0;
+
+                // Keep the buffer for the next backlog, unless it was grown
+                // by an unusually large one
+                if (bytes_.capacity() > kMaxRetainedSize) {
+                    std::vector<char>().swap(bytes_);
+                    std::vector<int>().swap(sizes_);
+                }
+            }
+        };
+
+        // Messages queued with push_urgent()
+        Lane urgent_;
+        // Messages queued with push_back()
+        Lane bulk_;
+    };
+} // namespace fserv::util
@@ -5,9 +5,15 @@
 #pragma once
 
 #include "client_pool.hpp"
+#include "metrics.hpp"
+#include "mutex.hpp"
 #include "server_session.hpp"
+#include "trace.hpp"
+#include <functional>
 #include <map>
 #include <mutex>
+#include <utility>
+#include <vector>
 #include <sys/epoll.h>
 
 namespace fserv {
@@ -47,7 +53,7 @@ namespace fserv {
         {
             {
                 // Maybe start the server (if not already running)
-                std::lock_guard<std::mutex> l(status_check_lock_);
+                std::lock_guard<util::Mutex> l(status_check_lock_);
                 if (!client_pool_.run(
                         worker_count, max_client_count, timeout_interval)) {
                     return;
@@ -56,43 +62,225 @@ namespace fserv {
                 // Start server
                 // Server instance listens on only one thread
                 server_count_ = std::make_unique<std::atomic<int>>(1);
+
+                // Listener health is checked from the listening thread
+                if (health_interval_ > 0 && epoll_.enable_timer()) {
+                    netstat_read_ = util::read_listen_counters(
+                        &netstat_overflows_, &netstat_drops_);
+                    epoll_.set_timer(health_interval_);
+                }
+
+                // Accepts are traced in a ring of the listening thread
+                const int trace_ring_size
+                    = client_pool_.options().trace_ring_size;
+                trace_ring_.reset();
+                if (trace_ring_size > 0) {
+                    trace_ring_
+                        = std::make_unique<util::TraceRing>(trace_ring_size);
+                    util::TraceRegistry::add(trace_ring_.get());
+                }
             }
 
+            util::TraceRing::set_current(trace_ring_.get());
             epoll_.wait(this);
+            util::TraceRing::set_current(nullptr);
+
+            if (trace_ring_) {
+                util::TraceRegistry::remove(trace_ring_.get());
+            }
         }
 
         //! Stops listening on all server sockets.
         void stop()
         {
             // Maybe stop the server (if already running)
-            std::lock_guard<std::mutex> l(status_check_lock_);
+            std::lock_guard<util::Mutex> l(status_check_lock_);
 
             epoll_.close();
             client_pool_.stop();
         }
 
+        //! Sets the tunables applied to accepted clients.
+        //! @param options
+        //!     Client connection tunables
+        void set_client_options(const ClientOptions& options)
+        {
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+            client_pool_.set_options(options);
+        }
+
+        //! Sets the handler called from the watchdog thread when a worker is
+        //! found stalled.
+        //! @param fn
+        //!     Handler, passed the stall found
+        void set_stall_handler(
+            const std::function<void(const StallReport&)>& fn)
+        {
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+            client_pool_.set_stall_handler(fn);
+        }
+
+        //! @return
+        //!     Index of the worker running the caller, -1 if the caller is
+        //!     not a worker
+        static int worker()
+        {
+            return ClientPool<PacketSinkType, ClientType>::worker();
+        }
+
+        //! @return
+        //!     Number of clients retired for reaching their maximum age
+        std::uint64_t retired_client_count() const
+        {
+            return client_pool_.retired_client_count();
+        }
+
+        //! @return
+        //!     Distributions of the TCP_INFO samples taken so far
+        TcpMetrics tcp_metrics() const
+        {
+            return client_pool_.tcp_metrics();
+        }
+
+        //! @return
+        //!     Relays started so far, and the bytes they moved
+        RelayMetrics relay_metrics() const
+        {
+            return client_pool_.relay_metrics();
+        }
+
+        //! @return
+        //!     Recent events of each worker, then of the listening thread,
+        //!     oldest first, empty if tracing is disabled
+        std::vector<std::vector<TraceRecord>> trace_snapshot() const
+        {
+            auto snapshot = client_pool_.trace_snapshot();
+
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+            if (trace_ring_) {
+                snapshot.push_back(trace_ring_->snapshot());
+            }
+
+            return snapshot;
+        }
+
+        //! Writes the recent events of each worker, then of the listening
+        //! thread, as text.
+        //! @param fd
+        //!     File descriptor
+        void dump_trace(int fd) const
+        {
+            client_pool_.dump_trace(fd);
+
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+            if (trace_ring_) {
+                trace_ring_->dump(fd, -1);
+            }
+        }
+
+        //! @return
+        //!     Contention of the fserv mutexes, per declaration site, empty
+        //!     unless built with FSERV_PROFILE_LOCKS
+        std::vector<LockSiteMetrics> lock_metrics() const
+        {
+            return util::LockSites::snapshot();
+        }
+
+        //! @return
+        //!     Workers found stalled so far
+        StallMetrics stall_metrics() const
+        {
+            return client_pool_.stall_metrics();
+        }
+
+        //! Sets the period of listener health checks, which read the accept
+        //! queue of each listener and the listener drop counters. Applied
+        //! on next run.
+        //! @param interval
+        //!     Period (ms), zero to disable
+        void set_health_interval(int interval)
+        {
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+            health_interval_ = interval > 0 ? interval : 0;
+        }
+
+        //! Sets the handler called from the listening thread when a health
+        //! check finds connections dropped by listeners.
+        //! @param fn
+        //!     Handler, passed the listener metrics
+        void set_overflow_handler(
+            const std::function<void(const ListenerMetrics&)>& fn)
+        {
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+            overflow_handler_ = fn;
+        }
+
+        //! @return
+        //!     Health of the listener sockets
+        ListenerMetrics listener_metrics() const
+        {
+            ListenerMetrics metrics;
+            metrics.accept_count
+                = accept_count_.load(std::memory_order_relaxed);
+            metrics.accepts_per_wakeup = accepts_per_wakeup_.snapshot();
+
+            std::lock_guard<util::Mutex> l(metrics_lock_);
+            metrics.listen_overflows = listen_overflows_;
+            metrics.listen_drops = listen_drops_;
+            metrics.backlogs = backlogs_;
+            metrics.checked_at = checked_at_;
+            return metrics;
+        }
+
         //! Binds a listener socket to a port.
         //! @param port
         //!     Port number
         //! @param queuelen
         //!     Backlog queue length for accept()
+        //! @param timeouts
+        //!     Deadlines of the accepted clients
         //! @return
         //!     True if binding is successful, false otherwise
-        bool bind(int port, int queuelen)
+        bool bind(int port,
+                  int queuelen,
+                  const ClientTimeouts& timeouts = ClientTimeouts())
         {
-            std::lock_guard<std::mutex> l(status_check_lock_);
-            return do_bind(port, queuelen);
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+            return do_bind(port, queuelen, timeouts);
         }
 
         //! Adds an existing listener socket.
         //! @param sfd
         //!     File descriptor
+        //! @param timeouts
+        //!     Deadlines of the accepted clients
         //! @return
         //!     True if adding is successful, false otherwise
-        bool add(int sfd)
+        bool add(int sfd, const ClientTimeouts& timeouts = ClientTimeouts())
+        {
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+            return do_add(sfd, timeouts);
+        }
+
+        //! Starts an outbound connection, served by the same workers as the
+        //! accepted clients. May be called from any thread while running,
+        //! including from a handler.
+        //! @param addr
+        //!     Remote address
+        //! @param callback
+        //!     Called once the connection is established or has failed
+        //! @param timeouts
+        //!     Deadlines of the connection
+        //! @return
+        //!     True if the connect was started, false otherwise
+        bool connect(const sockaddr_in& addr,
+                     ConnectCallback<ClientType>&& callback,
+                     const ClientTimeouts& timeouts = ClientTimeouts())
         {
-            std::lock_guard<std::mutex> l(status_check_lock_);
-            return do_add(sfd);
+            // Not locked: the status lock is held while workers are joined
+            return client_pool_.connect_client(
+                       addr, std::move(callback), timeouts)
+                   != nullptr;
         }
 
         //! Called on epoll event to handle connection requests.
@@ -101,9 +289,12 @@ namespace fserv {
         //! @param flags
         //!     Event flags
         void trigger(ServerSession* server, int flags);
+
+        //! Checks listener health.
+        void timer_triggered();
     private:
         /* @helper */
-        bool do_bind(int port, int queuelen)
+        bool do_bind(int port, int queuelen, const ClientTimeouts& timeouts)
         {
             int sfd = util::endpoint_tcp_server(port, queuelen);
             if (sfd == -1) {
@@ -114,14 +305,14 @@ namespace fserv {
                 return util::endpoint_close(sfd), false;
             }
 
-            bool ret = do_add(sfd);
+            bool ret = do_add(sfd, timeouts);
             if (!ret)
                 util::endpoint_close(sfd);
             return ret;
         }
 
         /* @helper */
-        bool do_add(int sfd)
+        bool do_add(int sfd, const ClientTimeouts& timeouts)
         {
             int uuid = 1;
             if (!servers_.empty()) {
@@ -129,7 +320,7 @@ namespace fserv {
                 uuid = top->first + 1;
             }
 
-            servers_[uuid] = ServerSession(uuid, sfd);
+            servers_[uuid] = ServerSession(uuid, sfd, timeouts);
             ServerSession* server = &servers_[uuid];
 
             int flags = EPOLLIN | EPOLLET | EPOLLEXCLUSIVE;
@@ -137,10 +328,11 @@ namespace fserv {
         }
 
         // Applied when starting and stopping the running instance
-        mutable std::mutex status_check_lock_;
+        mutable util::Mutex status_check_lock_{
+            "ServerPool::status_check_lock_"};
 
         // Synchronizes access to list of bound servers
-        mutable std::mutex server_add_lock_;
+        mutable util::Mutex server_add_lock_{"ServerPool::server_add_lock_"};
 
         // Map of bound servers
         std::map<int, ServerSession, std::greater<>> servers_;
@@ -154,6 +346,30 @@ namespace fserv {
         //
         EpollWaiter<ServerPool<PacketSinkType, ClientType>, ServerSession>
             epoll_;
+
+        // Recent accepts, null if tracing is disabled
+        std::unique_ptr<util::TraceRing> trace_ring_;
+
+        // Period of listener health checks (ms), zero if disabled
+        int health_interval_ = 0;
+        // Called when a health check finds dropped connections
+        std::function<void(const ListenerMetrics&)> overflow_handler_;
+        // Number of connections accepted
+        std::atomic<std::uint64_t> accept_count_ = 0;
+        // Connections accepted per listener wakeup
+        util::Histogram accepts_per_wakeup_;
+        // Last readings of the listener drop counters
+        std::uint64_t netstat_overflows_ = 0;
+        std::uint64_t netstat_drops_ = 0;
+        // Whether the readings above were taken, drops being counted from
+        // them only once they are
+        bool netstat_read_ = false;
+        // Results of the health checks, guarded by metrics_lock_
+        std::uint64_t listen_overflows_ = 0;
+        std::uint64_t listen_drops_ = 0;
+        std::vector<ListenerBacklog> backlogs_;
+        std::int64_t checked_at_ = 0;
+        mutable util::Mutex metrics_lock_{"ServerPool::metrics_lock_"};
     };
 
     /*! Called on epoll event to handle connection requests.
@@ -173,15 +389,87 @@ namespace fserv {
             default:
             {
                 int cfd;
+                std::uint64_t accepted = 0;
                 while ((cfd = util::endpoint_accept(server->sfd)) != -1) {
+                    ++accepted;
                     if (util::endpoint_unblock(cfd) != 0) {
                         util::endpoint_close(cfd);
                         continue;
                     }
 
-                    client_pool_.add_client(cfd);
+                    int uuid = -1;
+                    auto* client = client_pool_.add_client(cfd,
+                                                           server->timeouts);
+                    if (client != nullptr) {
+                        uuid = static_cast<util::StackNode<ClientType>*>(client)
+                                   ->uuid;
+                    }
+
+                    FSERV_TRACE(accept, kAccept, uuid, 0);
+                }
+
+                accept_count_.fetch_add(accepted, std::memory_order_relaxed);
+                accepts_per_wakeup_.record(accepted);
+            }
+        }
+    }
+
+    /*! Checks listener health.
+     */
+    template <typename PacketSinkType, typename ClientType>
+    void ServerPool<PacketSinkType, ClientType>::timer_triggered()
+    {
+        std::vector<ListenerBacklog> backlogs;
+        std::function<void(const ListenerMetrics&)> overflow_handler;
+        {
+            std::lock_guard<util::Mutex> l(status_check_lock_);
+            epoll_.set_timer(health_interval_);
+            overflow_handler = overflow_handler_;
+
+            // On a listener, TCP_INFO reports the accept queue length and
+            // its limit in place of the unacknowledged and SACKed counts
+            for (const auto& s: servers_) {
+                const ServerSession& server = s.second;
+                struct tcp_info info = {};
+                socklen_t size = sizeof(info);
+                if (::getsockopt(
+                        server.sfd, IPPROTO_TCP, TCP_INFO, &info, &size)
+                    == 0) {
+                    backlogs.push_back(ListenerBacklog{
+                        server.uuid, info.tcpi_unacked, info.tcpi_sacked});
                 }
             }
         }
+
+        epoll_.rearm_timer();
+
+        // Counters are system-wide totals since boot, so a first reading
+        // only sets the baseline the next ones are compared with
+        std::uint64_t overflows = 0;
+        std::uint64_t drops = 0;
+        const bool read = util::read_listen_counters(&overflows, &drops);
+        const bool counted = read && netstat_read_;
+        const bool dropped = counted
+            && (overflows != netstat_overflows_ || drops != netstat_drops_);
+
+        {
+            std::lock_guard<util::Mutex> l(metrics_lock_);
+            if (counted) {
+                listen_overflows_ += overflows - netstat_overflows_;
+                listen_drops_ += drops - netstat_drops_;
+            }
+            backlogs_ = std::move(backlogs);
+            checked_at_ = util::CoarseClock::now_ms();
+        }
+
+        if (read) {
+            netstat_overflows_ = overflows;
+            netstat_drops_ = drops;
+            netstat_read_ = true;
+        }
+
+        if (dropped && overflow_handler) {
+            overflow_handler(listener_metrics());
+        }
     }
 } // namespace fserv
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include "client_options.hpp"
+
 namespace fserv {
 
     //! @struct ServerSession
@@ -11,14 +13,17 @@ namespace fserv {
     struct ServerSession {
         int uuid = 0;
         int sfd = 0;
+        // Deadlines of the clients accepted on the socket
+        ClientTimeouts timeouts;
 
         //! Ctor.
         ServerSession() = default;
 
         //! Ctor.
-        ServerSession(int uuid, int sfd)
+        ServerSession(int uuid, int sfd, const ClientTimeouts& timeouts)
             : uuid(uuid)
             , sfd(sfd)
+            , timeouts(timeouts)
         {}
     };
 } // namespace fserv
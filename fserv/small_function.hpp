@@ -0,0 +1,155 @@
+/* small_function.hpp -- v1.0
+   Move-only callable wrapper that stores small callables inline */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace fserv::util {
+
+    template <typename Signature, std::size_t kInlineSize = 48>
+    class SmallFunction;
+
+    //! @class SmallFunction
+    /*! Type-erased, move-only callable. Callables of up to kInlineSize bytes
+     *! are stored inline, without allocating; larger ones are moved to the
+     *! heap.
+     */
+    template <typename ReturnType,
+              typename... ArgTypes,
+              std::size_t kInlineSize>
+    class SmallFunction<ReturnType(ArgTypes...), kInlineSize> {
+    public:
+        //! Ctor.
+        //! Holds no callable.
+        SmallFunction() = default;
+
+        //! Ctor.
+        //! @param fn
+        //!     Callable, moved into the wrapper
+        template <typename FnType,
+                  typename = std::enable_if_t<
+                      !std::is_same_v<std::decay_t<FnType>, SmallFunction>>>
+        SmallFunction(FnType&& fn) // NOLINT
+        {
+            using StoredType = std::decay_t<FnType>;
+
+            if constexpr (is_inline<StoredType>()) {
+                new (storage_) StoredType(std::forward<FnType>(fn));
+                ops_ = &kInlineOps<StoredType>;
+            } else {
+                *reinterpret_cast<StoredType**>(storage_)
+                    = new StoredType(std::forward<FnType>(fn));
+                ops_ = &kHeapOps<StoredType>;
+            }
+        }
+
+        //! Dtor.
+        ~SmallFunction()
+        {
+            reset();
+        }
+
+        //! Move ctor.
+        SmallFunction(SmallFunction&& other) noexcept
+        {
+            *this = std::move(other);
+        }
+
+        //! Move assignment.
+        SmallFunction& operator=(SmallFunction&& other) noexcept
+        {
+            if (this != &other) {
+                reset();
+                if (other.ops_) {
+                    other.ops_->move(other.storage_, storage_);
+                    ops_ = other.ops_;
+                    other.ops_ = nullptr;
+                }
+            }
+
+            return *this;
+        }
+
+        //! Destroys the held callable.
+        void reset()
+        {
+            if (ops_) {
+                ops_->destroy(storage_);
+                ops_ = nullptr;
+            }
+        }
+
+        //! @return
+        //!     True if a callable is held
+        explicit operator bool() const
+        {
+            return ops_ != nullptr;
+        }
+
+        //! Invokes the held callable.
+        ReturnType operator()(ArgTypes... args)
+        {
+            return ops_->invoke(storage_, std::forward<ArgTypes>(args)...);
+        }
+
+        // Non-copyable object
+        SmallFunction(const SmallFunction&) = delete;
+        SmallFunction& operator=(const SmallFunction&) = delete;
+    private:
+        //! @struct Ops
+        /*! Operations on the stored callable
+         */
+        struct Ops {
+            ReturnType (*invoke)(void*, ArgTypes&&...);
+            void (*move)(void*, void*);
+            void (*destroy)(void*);
+        };
+
+        /* @helper */
+        template <typename StoredType>
+        static constexpr bool is_inline()
+        {
+            return sizeof(StoredType) <= kInlineSize
+                   && alignof(StoredType) <= alignof(std::max_align_t)
+                   && std::is_nothrow_move_constructible_v<StoredType>;
+        }
+
+        template <typename StoredType>
+        static constexpr Ops kInlineOps = {
+            [](void* ptr, ArgTypes&&... args) -> ReturnType {
+                return (*static_cast<StoredType*>(ptr))(
+                    std::forward<ArgTypes>(args)...);
+            },
+            [](void* from, void* to) {
+                auto* fn = static_cast<StoredType*>(from);
+                new (to) StoredType(std::move(*fn));
+                fn->~StoredType();
+            },
+            [](void* ptr) {
+                static_cast<StoredType*>(ptr)->~StoredType();
+            }};
+
+        template <typename StoredType>
+        static constexpr Ops kHeapOps = {
+            [](void* ptr, ArgTypes&&... args) -> ReturnType {
+                return (**static_cast<StoredType**>(ptr))(
+                    std::forward<ArgTypes>(args)...);
+            },
+            [](void* from, void* to) {
+                *static_cast<StoredType**>(to)
+                    = *static_cast<StoredType**>(from);
+            },
+            [](void* ptr) {
+                delete *static_cast<StoredType**>(ptr);
+            }};
+
+        // Inline callable, or pointer to the heap-allocated one
+        alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+        // Operations on the held callable, null if none is held
+        const Ops* ops_ = nullptr;
+    };
+} // namespace fserv::util
@@ -0,0 +1,223 @@
+/* timer_wheel.hpp -- v1.0
+   Hashed timing wheel of millisecond deadlines */
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+namespace fserv::util {
+
+    //! @class TimerWheel
+    /*! Deadlines hashed into a ring of one-millisecond slots. Scheduling and
+     *! cancelling are constant-time; deadlines further away than one turn of
+     *! the ring stay in their slot until the turn they fall in. Entries are
+     *! recycled through a free list, so that a steady timer population does
+     *! not allocate. Not thread-safe.
+     */
+    template <typename PayloadType>
+    class TimerWheel {
+        static constexpr int kSlotCount = 4096;
+        static constexpr int kSlotMask = kSlotCount - 1;
+        static constexpr int kWordBits = 64;
+    public:
+        using Handle = std::uint32_t;
+        static constexpr Handle kNullHandle = ~Handle(0);
+
+        //! Ctor.
+        //! @param now
+        //!     Current time (ms)
+        explicit TimerWheel(std::int64_t now = 0)
+            : current_(now)
+        {
+            for (auto& head: heads_) {
+                head = kNullHandle;
+            }
+        }
+
+        //! Schedules a deadline.
+        //! @param deadline
+        //!     Expiry time (ms); past deadlines expire on the next advance
+        //! @param payload
+        //!     Handed back on expiry
+        //! @return
+        //!     Handle to cancel the deadline with
+        Handle schedule(std::int64_t deadline, PayloadType payload)
+        {
+            if (deadline <= current_) {
+                deadline = current_ + 1;
+            }
+
+            Handle handle = free_head_;
+            if (handle == kNullHandle) {
+                handle = static_cast<Handle>(nodes_.size());
+                nodes_.emplace_back();
+            } else {
+                free_head_ = nodes_[handle].next;
+            }
+
+            Node& node = nodes_[handle];
+            node.deadline = deadline;
+            node.payload = std::move(payload);
+            link(handle, static_cast<int>(deadline & kSlotMask));
+
+            ++size_;
+            return handle;
+        }
+
+        //! Cancels a scheduled deadline.
+        //! @param handle
+        //!     Handle returned by schedule(), not yet expired or cancelled
+        void cancel(Handle handle)
+        {
+            unlink(handle);
+            release(handle);
+        }
+
+        //! Expires all deadlines up to the passed time.
+        //! @param now
+        //!     Current time (ms)
+        //! @param on_expired
+        //!     Called with each expired payload, after its handle is
+        //!     released; may schedule further deadlines, but not cancel any
+        template <typename CallbackType>
+        void advance(std::int64_t now, CallbackType&& on_expired)
+        {
+            if (now <= current_) {
+                return;
+            }
+
+            // A gap longer than one turn visits every slot once
+            const std::int64_t last
+                = now - current_ > kSlotCount ? current_ + kSlotCount : now;
+            const std::int64_t first = current_ + 1;
+
+            // Deadlines scheduled from the callbacks land past the new time
+            current_ = now;
+
+            for (std::int64_t tick = first; tick <= last; ++tick) {
+                const int slot = static_cast<int>(tick & kSlotMask);
+
+                Handle handle = heads_[slot];
+                while (handle != kNullHandle) {
+                    Node& node = nodes_[handle];
+                    const Handle next = node.next;
+
+                    if (node.deadline <= now) {
+                        unlink(handle);
+                        PayloadType payload = std::move(node.payload);
+                        release(handle);
+                        on_expired(std::move(payload));
+                    }
+
+                    handle = next;
+                }
+            }
+        }
+
+        //! @return
+        //!     Earliest time at which a deadline may expire, -1 if none is
+        //!     scheduled. Deadlines more than a turn away are reported at
+        //!     their slot's next turn.
+        std::int64_t next_expiry() const
+        {
+            if (size_ == 0) {
+                return -1;
+            }
+
+            int slot = static_cast<int>((current_ + 1) & kSlotMask);
+            for (int scanned = 0; scanned <= kSlotCount;) {
+                const int bit = slot % kWordBits;
+                const std::uint64_t bits = occupied_[slot / kWordBits] >> bit;
+                if (bits != 0) {
+                    return current_ + 1 + scanned + std::countr_zero(bits);
+                }
+
+                // Move on to the start of the next word
+                scanned += kWordBits - bit;
+                slot = (slot + kWordBits - bit) & kSlotMask;
+            }
+
+            return current_ + kSlotCount;
+        }
+
+        //! @return
+        //!     Number of scheduled deadlines
+        std::size_t size() const
+        {
+            return size_;
+        }
+    private:
+        //! @struct Node
+        /*! Scheduled deadline, linked into its slot
+         */
+        struct Node {
+            std::int64_t deadline = 0;
+            Handle prev = kNullHandle;
+            Handle next = kNullHandle;
+            PayloadType payload = PayloadType();
+        };
+
+        // Entries, addresses stable as the container grows
+        std::deque<Node> nodes_;
+        // First entry of each slot
+        Handle heads_[kSlotCount];
+        // One bit per non-empty slot
+        std::uint64_t occupied_[kSlotCount / kWordBits] = {};
+        // Released entries, linked through next
+        Handle free_head_ = kNullHandle;
+        // Time up to which deadlines have expired (ms)
+        std::int64_t current_ = 0;
+        // Number of scheduled deadlines
+        std::size_t size_ = 0;
+
+        /* @helper */
+        void link(Handle handle, int slot)
+        {
+            Node& node = nodes_[handle];
+            node.prev = kNullHandle;
+            node.next = heads_[slot];
+            if (node.next != kNullHandle) {
+                nodes_[node.next].prev = handle;
+            }
+
+            heads_[slot] = handle;
+            occupied_[slot / kWordBits]
+                |= std::uint64_t(1) << (slot % kWordBits);
+        }
+
+        /* @helper */
+        void unlink(Handle handle)
+        {
+            Node& node = nodes_[handle];
+            const int slot = static_cast<int>(node.deadline & kSlotMask);
+
+            if (node.prev != kNullHandle) {
+                nodes_[node.prev].next = node.next;
+            } else {
+                heads_[slot] = node.next;
+            }
+
+            if (node.next != kNullHandle) {
+                nodes_[node.next].prev = node.prev;
+            }
+
+            if (heads_[slot] == kNullHandle) {
+                occupied_[slot / kWordBits]
+                    &= ~(std::uint64_t(1) << (slot % kWordBits));
+            }
+        }
+
+        /* @helper */
+        void release(Handle handle)
+        {
+            Node& node = nodes_[handle];
+            node.payload = PayloadType();
+            node.next = free_head_;
+            free_head_ = handle;
+            --size_;
+        }
+    };
+} // namespace fserv::util
@@ -0,0 +1,342 @@
+/* trace.hpp -- v1.0
+   Per-worker rings of recent events, and USDT probes at the same sites */
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// USDT probes, a single no-op instruction until a tracer attaches, such as
+// bpftrace -e 'usdt:./server:fserv:read { @[arg0] = sum(arg1); }'
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define FSERV_PROBE(name, uuid, bytes) DTRACE_PROBE2(fserv, name, uuid, bytes)
+#else
+#define FSERV_PROBE(name, uuid, bytes) ((void)(uuid), (void)(bytes))
+#endif
+
+// Fires the named probe and records the event in this thread's trace ring
+#define FSERV_TRACE(name, event, uuid, bytes)                                 \
+    do {                                                                      \
+        FSERV_PROBE(name, uuid, bytes);                                       \
+        ::fserv::util::trace(::fserv::TraceEvent::event, uuid, bytes);        \
+    } while (0)
+
+namespace fserv {
+
+    //! @enum TraceEvent
+    /*! Event recorded in a trace ring
+     */
+    enum class TraceEvent : std::uint8_t {
+        kAccept,
+        kRead,
+        kWrite,
+        kRearm,
+        kClose,
+        kTimeout,
+        kConnect
+    };
+
+    //! @struct TraceRecord
+    /*! Event recorded in a trace ring
+     */
+    struct TraceRecord {
+        // Time stamp counter, or steady clock nanoseconds where there is none
+        std::uint64_t tsc = 0;
+        // Client uuid, -1 if none
+        std::int32_t uuid = -1;
+        // Bytes read or written, queued output for a rearm, or the error
+        // of a connect
+        std::int32_t bytes = 0;
+        TraceEvent event = TraceEvent::kAccept;
+    };
+} // namespace fserv
+
+namespace fserv::util {
+
+    //! @return
+    //!     Time stamp counter, or steady clock nanoseconds where there is
+    //!     none
+    inline std::uint64_t read_tsc()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    //! @class TraceRing
+    /*! Last events recorded by one thread, overwritten oldest first.
+     *! Written by its thread only, without locking; read from any thread.
+     */
+    class TraceRing {
+    public:
+        //! Ctor.
+        //! @param capacity
+        //!     Number of events kept, rounded up to a power of two
+        explicit TraceRing(int capacity)
+        {
+            std::uint64_t size = 1;
+            while (size < static_cast<std::uint64_t>(capacity)) {
+                size <<= 1;
+            }
+
+            records_ = std::make_unique<TraceRecord[]>(size);
+            mask_ = size - 1;
+        }
+
+        //! Records an event.
+        //! Must be called by the ring's thread.
+        //! @param event
+        //!     Event
+        //! @param uuid
+        //!     Client uuid, -1 if none
+        //! @param bytes
+        //!     Byte count
+        void record(TraceEvent event, int uuid, int bytes)
+        {
+            const std::uint64_t head = head_.load(std::memory_order_relaxed);
+            TraceRecord& record = records_[head & mask_];
+
+            // Pairs with the fence in snapshot(): a reader seeing any of
+            // these writes then sees head_ moved past the record overwritten
+            std::atomic_thread_fence(std::memory_order_release);
+            record.tsc = read_tsc();
+            record.uuid = uuid;
+            record.bytes = bytes;
+            record.event = event;
+            head_.store(head + 1, std::memory_order_release);
+        }
+
+        //! @return
+        //!     Events kept, oldest first. Events overwritten while being
+        //!     read are left out.
+        std::vector<TraceRecord> snapshot() const
+        {
+            const std::uint64_t size = mask_ + 1;
+            const std::uint64_t head = head_.load(std::memory_order_acquire);
+            const std::uint64_t first = head > size ? head - size : 0;
+
+            std::vector<TraceRecord> records;
+            records.reserve(head - first);
+            for (std::uint64_t i = first; i != head; ++i) {
+                records.push_back(records_[i & mask_]);
+            }
+
+            // The writer may have overwritten the oldest records, and be
+            // writing the next one. The fence keeps the record reads above
+            // ahead of the second head_ load.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const std::uint64_t after = head_.load(std::memory_order_relaxed);
+            const std::uint64_t valid = after >= size ? after - size + 1 : 0;
+            if (valid > first) {
+                const std::uint64_t stale = valid - first < records.size()
+                                                ? valid - first
+                                                : records.size();
+                records.erase(records.begin(), records.begin() + stale);
+            }
+
+            return records;
+        }
+
+        //! Writes the events kept as text, oldest first, one per line.
+        //! Async-signal-safe.
+        //! @param fd
+        //!     File descriptor
+        //! @param ring
+        //!     Ring number, printed with each event
+        void dump(int fd, int ring) const
+        {
+            static constexpr const char* kNames[] = {
+                "accept", "read", "write", "rearm", "close", "timeout", "connect"};
+
+            const std::uint64_t size = mask_ + 1;
+            const std::uint64_t head = head_.load(std::memory_order_acquire);
+            for (std::uint64_t i = head > size ? head - size : 0; i != head;
+                 ++i) {
+                const TraceRecord& record = records_[i & mask_];
+
+                char line[128];
+                char* p = line;
+                p = append(p, "ring ");
+                p = append(p, ring);
+                p = append(p, " tsc ");
+                p = append(p, record.tsc);
+                p = append(p, " ");
+                p = append(p, kNames[static_cast<int>(record.event)]);
+                p = append(p, " uuid ");
+                p = append(p, record.uuid);
+                p = append(p, " bytes ");
+                p = append(p, record.bytes);
+                *p++ = '\n';
+
+                [[maybe_unused]] auto n = ::write(fd, line, p - line);
+            }
+        }
+
+        //! @return
+        //!     Ring of this thread, null if none
+        static TraceRing* current()
+        {
+            return current_;
+        }
+
+        //! Sets the ring of this thread.
+        //! @param ring
+        //!     Ring, null for none
+        static void set_current(TraceRing* ring)
+        {
+            current_ = ring;
+        }
+    private:
+        // Events, indexed by sequence number modulo the capacity
+        std::unique_ptr<TraceRecord[]> records_;
+        // Capacity less one
+        std::uint64_t mask_ = 0;
+        // Sequence number of the next event
+        std::atomic<std::uint64_t> head_ = 0;
+
+        // Ring of this thread
+        inline static thread_local TraceRing* current_ = nullptr;
+
+        /* @helper */
+        static char* append(char* p, const char* s)
+        {
+            while (*s) {
+                *p++ = *s++;
+            }
+
+            return p;
+        }
+
+        /* @helper */
+        static char* append(char* p, std::int64_t value)
+        {
+            if (value < 0) {
+                *p++ = '-';
+                return append(p, static_cast<std::uint64_t>(-value));
+            }
+
+            return append(p, static_cast<std::uint64_t>(value));
+        }
+
+        /* @helper */
+        static char* append(char* p, std::uint64_t value)
+        {
+            char digits[20];
+            int n = 0;
+            do {
+                digits[n++] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            } while (value != 0);
+
+            while (n != 0) {
+                *p++ = digits[--n];
+            }
+
+            return p;
+        }
+
+        /* @helper */
+        static char* append(char* p, int value)
+        {
+            return append(p, static_cast<std::int64_t>(value));
+        }
+    };
+
+    //! Records an event in this thread's trace ring, if it has one.
+    //! @param event
+    //!     Event
+    //! @param uuid
+    //!     Client uuid, -1 if none
+    //! @param bytes
+    //!     Byte count
+    inline void trace(TraceEvent event, int uuid, int bytes)
+    {
+        TraceRing* ring = TraceRing::current();
+        if (ring != nullptr) {
+            ring->record(event, uuid, bytes);
+        }
+    }
+
+    //! @class TraceRegistry
+    /*! Trace rings of the running pools, dumped together on signal
+     */
+    class TraceRegistry {
+    public:
+        // Maximum number of rings registered at a time
+        static constexpr int kMaxRings = 256;
+
+        //! Registers a ring.
+        //! @param ring
+        //!     Ring, left unregistered if the registry is full
+        static void add(TraceRing* ring)
+        {
+            for (auto& slot: rings_) {
+                TraceRing* expected = nullptr;
+                if (slot.compare_exchange_strong(expected, ring)) {
+                    return;
+                }
+            }
+        }
+
+        //! Unregisters a ring.
+        //! @param ring
+        //!     Ring
+        static void remove(TraceRing* ring)
+        {
+            for (auto& slot: rings_) {
+                TraceRing* expected = ring;
+                if (slot.compare_exchange_strong(expected, nullptr)) {
+                    return;
+                }
+            }
+        }
+
+        //! Writes the events of all registered rings as text.
+        //! Async-signal-safe.
+        //! @param fd
+        //!     File descriptor
+        static void dump(int fd)
+        {
+            for (int i = 0; i != kMaxRings; ++i) {
+                const TraceRing* ring = rings_[i].load();
+                if (ring != nullptr) {
+                    ring->dump(fd, i);
+                }
+            }
+        }
+
+        //! Dumps all registered rings to stderr whenever a signal is
+        //! received.
+        //! @param signo
+        //!     Signal number
+        static void install_dump_handler(int signo)
+        {
+            struct sigaction action = {};
+            action.sa_handler = [](int) {
+                const int saved_errno = errno;
+                dump(STDERR_FILENO);
+                errno = saved_errno;
+            };
+
+            action.sa_flags = SA_RESTART;
+            sigemptyset(&action.sa_mask);
+            ::sigaction(signo, &action, nullptr);
+        }
+    private:
+        inline static std::atomic<TraceRing*> rings_[kMaxRings] = {};
+    };
+} // namespace fserv::util
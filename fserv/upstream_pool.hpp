@@ -0,0 +1,446 @@
+/* upstream_pool.hpp -- v1.0
+   Per-worker pools of persistent connections to a backend, served by the
+   same workers as the server's clients */
+
+#pragma once
+
+#include "basic_server.hpp"
+#include "client_session.hpp"
+#include "coarse_clock.hpp"
+#include "metrics.hpp"
+#include "small_function.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace fserv {
+
+    //! @struct UpstreamOptions
+    /*! Upstream pool tunables, set as the pool is created
+     */
+    struct UpstreamOptions {
+        // Number of workers the server runs, each owning its connections
+        int worker_count = 1;
+
+        // Maximum number of connections per worker, established or being
+        // established
+        int max_connections = 8;
+
+        // Maximum number of leases held on one connection at a time. Above
+        // one, requests are pipelined, and their responses arrive in the
+        // order the requests were written.
+        int max_pipeline = 1;
+
+        // Period (ms) at which each idle connection is checked, zero to
+        // disable. A connection the peer has closed is closed.
+        int health_interval = 0;
+
+        // Time (ms) after which a health check closes a connection left
+        // idle, zero to keep idle connections open
+        int idle_timeout = 0;
+
+        // Deadlines of the connections, such as connect to bound the
+        // connect
+        ClientTimeouts timeouts;
+    };
+
+    //! @struct UpstreamLease
+    /*! Identifies a lease held on an upstream connection
+     */
+    struct UpstreamLease {
+        int index = -1;
+        std::uint32_t sequence = 0;
+    };
+
+    //! @class UpstreamPool
+    /*! Keeps connections to one backend open across requests. Each worker
+     *! leases from the connections it opened, without locking, and any
+     *! worker may release a lease. Connections are clients of the server,
+     *! their events handled by the pool rather than the server's callbacks.
+     */
+    template <typename ClientType>
+    class UpstreamPool {
+        using ClientSessionType = ClientSession<ClientType>;
+
+        // Connection states, or the number of leases held
+        static constexpr std::int32_t kFree = -4;
+        static constexpr std::int32_t kConnecting = -3;
+        static constexpr std::int32_t kClosed = -2;
+        static constexpr std::int32_t kChecking = -1;
+    public:
+        //! Called with a leased connection and its lease, or with an errno
+        //! value if no connection could be established
+        using LeaseCallback = util::
+            SmallFunction<void(ClientSessionType&, UpstreamLease, int)>;
+
+        //! Ctor.
+        //! @param server
+        //!     Server whose workers serve the connections, must outlive the
+        //!     pool's use
+        //! @param ipaddr
+        //!     Backend ip address
+        //! @param port
+        //!     Backend port number
+        //! @param options
+        //!     Tunables
+        UpstreamPool(BasicServer<ClientType>* server,
+                     const char* ipaddr,
+                     int port,
+                     const UpstreamOptions& options = UpstreamOptions())
+            : server_(server)
+            , ipaddr_(ipaddr)
+            , port_(port)
+            , options_(options)
+        {
+            if (options_.worker_count < 1) {
+                options_.worker_count = 1;
+            }
+
+            if (options_.max_connections < 1) {
+                options_.max_connections = 1;
+            }
+
+            if (options_.max_pipeline < 1) {
+                options_.max_pipeline = 1;
+            }
+
+            connections_ = std::make_unique<Connection[]>(
+                options_.worker_count * options_.max_connections);
+            for (int i = 0;
+                 i != options_.worker_count * options_.max_connections;
+                 ++i) {
+                connections_[i].pool = this;
+            }
+        }
+
+        //! Sets the callback called with the data received on a connection,
+        //! which rearms the connection as the server's handlers do. Must be
+        //! set before leasing.
+        //! @param fn
+        //!     Callback function
+        void bind_response_callback(
+            const std::function<
+                void(ClientSessionType&, const char*, const int)>& fn)
+        {
+            on_response_ = fn;
+        }
+
+        //! Sets the callback called when a connection closes, leased or
+        //! not. Leases held on it must still be released. Must be set before
+        //! leasing.
+        //! @param fn
+        //!     Callback function
+        void bind_closed_callback(
+            const std::function<void(ClientSessionType&)>& fn)
+        {
+            on_closed_ = fn;
+        }
+
+        //! Leases a connection of the calling worker. An open connection
+        //! with room for a lease is passed to the callback before returning;
+        //! otherwise a new connection is opened, if the worker has fewer
+        //! than the maximum, and passed once established. Must be called
+        //! from a worker, such as from a handler.
+        //! @param fn
+        //!     Callable taking the connection's session, the lease and an
+        //!     errno value, zero if leased
+        //! @return
+        //!     False if the callback will not be called: the caller is not
+        //!     a worker, or all of the worker's connections are in use
+        template <typename FnType>
+        bool lease(FnType&& fn)
+        {
+            const int worker = BasicServer<ClientType>::worker();
+            if (worker < 0 || worker >= options_.worker_count) {
+                return false;
+            }
+
+            const int first = worker * options_.max_connections;
+            const int last = first + options_.max_connections;
+
+            // Open connections first, reclaiming closed ones on the way
+            int free = -1;
+            for (int i = first; i != last; ++i) {
+                Connection& connection = connections_[i];
+                std::uint64_t word
+                    = connection.word.load(std::memory_order_acquire);
+                const std::int32_t state = state_of(word);
+
+                if (state == kClosed) {
+                    word = pack(sequence_of(word) + 1, kFree);
+                    connection.word.store(word, std::memory_order_release);
+                }
+
+                if (state_of(word) == kFree) {
+                    if (free == -1) {
+                        free = i;
+                    }
+
+                    continue;
+                }
+
+                if (state < 0 || state >= options_.max_pipeline) {
+                    continue;
+                }
+
+                // A health check or release may have raced the lease
+                if (!connection.word.compare_exchange_strong(
+                        word,
+                        pack(sequence_of(word), state + 1),
+                        std::memory_order_acq_rel)) {
+                    continue;
+                }
+
+                lease_count_.fetch_add(1, std::memory_order_relaxed);
+                reuse_count_.fetch_add(1, std::memory_order_relaxed);
+
+                ClientSessionType session = connection.session;
+                fn(session, UpstreamLease{i, sequence_of(word)}, 0);
+                return true;
+            }
+
+            if (free == -1) {
+                exhausted_count_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            return connect(free, LeaseCallback(std::forward<FnType>(fn)));
+        }
+
+        //! Releases a lease, from any thread. The connection is idle once
+        //! all of its leases are released.
+        //! @param lease
+        //!     Lease, ignored if its connection has closed
+        void release(UpstreamLease lease)
+        {
+            if (lease.index < 0
+                || lease.index
+                       >= options_.worker_count * options_.max_connections) {
+                return;
+            }
+
+            Connection& connection = connections_[lease.index];
+            std::uint64_t word
+                = connection.word.load(std::memory_order_acquire);
+            do {
+                if (sequence_of(word) != lease.sequence
+                    || state_of(word) <= 0) {
+                    return;
+                }
+            } while (!connection.word.compare_exchange_weak(
+                word,
+                pack(lease.sequence, state_of(word) - 1),
+                std::memory_order_acq_rel));
+
+            if (state_of(word) == 1) {
+                connection.idle_since.store(util::CoarseClock::now_ms(),
+                                            std::memory_order_relaxed);
+            }
+        }
+
+        //! @return
+        //!     Use of the pool's connections so far
+        UpstreamMetrics metrics() const
+        {
+            UpstreamMetrics metrics;
+            metrics.lease_count = lease_count_.load(std::memory_order_relaxed);
+            metrics.reuse_count = reuse_count_.load(std::memory_order_relaxed);
+            metrics.exhausted_count
+                = exhausted_count_.load(std::memory_order_relaxed);
+            metrics.connect_count
+                = connect_count_.load(std::memory_order_relaxed);
+            metrics.connect_failure_count
+                = connect_failure_count_.load(std::memory_order_relaxed);
+            metrics.health_close_count
+                = health_close_count_.load(std::memory_order_relaxed);
+            return metrics;
+        }
+
+        // Non-copyable object
+        UpstreamPool(const UpstreamPool&) = delete;
+        UpstreamPool& operator=(const UpstreamPool&) = delete;
+    private:
+        //! @struct Connection
+        /*! Pooled connection, handling the events of its client
+         */
+        struct Connection final : ClientEventHandler<ClientType> {
+            // Owning pool
+            UpstreamPool* pool = nullptr;
+            // Sequence number (high half), bumped as the slot is reused, and
+            // state (low half)
+            std::atomic<std::uint64_t> word = pack(0, kFree);
+            // Connection's session, set before its state turns to leased
+            ClientSessionType session{nullptr, -1};
+            // Time the last lease was released (ms)
+            std::atomic<std::int64_t> idle_since = 0;
+
+            void client_data_received(ClientSessionType& client,
+                                      const char* data,
+                                      const int size) override
+            {
+                if (pool->on_response_) {
+                    pool->on_response_(client, data, size);
+                }
+            }
+
+            void client_closed(ClientSessionType& client) override
+            {
+                // Reclaimed by the owning worker
+                std::uint64_t word = this->word.load(std::memory_order_acquire);
+                while (!this->word.compare_exchange_weak(
+                    word,
+                    pack(sequence_of(word), kClosed),
+                    std::memory_order_acq_rel)) {
+                }
+
+                if (pool->on_closed_) {
+                    pool->on_closed_(client);
+                }
+            }
+        };
+
+        // Server serving the connections
+        BasicServer<ClientType>* server_ = nullptr;
+        // Backend address
+        std::string ipaddr_;
+        int port_ = 0;
+        // Tunables
+        UpstreamOptions options_;
+        // Connections, max_connections per worker, in worker order
+        std::unique_ptr<Connection[]> connections_;
+
+        // Called with the data received on a connection
+        std::function<void(ClientSessionType&, const char*, const int)>
+            on_response_;
+        // Called when a connection closes
+        std::function<void(ClientSessionType&)> on_closed_;
+
+        // Statistics, read from any thread
+        std::atomic<std::uint64_t> lease_count_ = 0;
+        std::atomic<std::uint64_t> reuse_count_ = 0;
+        std::atomic<std::uint64_t> exhausted_count_ = 0;
+        std::atomic<std::uint64_t> connect_count_ = 0;
+        std::atomic<std::uint64_t> connect_failure_count_ = 0;
+        std::atomic<std::uint64_t> health_close_count_ = 0;
+
+        /* @helper */
+        static constexpr std::uint64_t pack(std::uint32_t sequence,
+                                            std::int32_t state)
+        {
+            return (static_cast<std::uint64_t>(sequence) << 32)
+                   | static_cast<std::uint32_t>(state);
+        }
+
+        /* @helper */
+        static constexpr std::int32_t state_of(std::uint64_t word)
+        {
+            return static_cast<std::int32_t>(word & 0xffffffff);
+        }
+
+        /* @helper */
+        static constexpr std::uint32_t sequence_of(std::uint64_t word)
+        {
+            return static_cast<std::uint32_t>(word >> 32);
+        }
+
+        /* @helper */
+        bool connect(int index, LeaseCallback&& callback)
+        {
+            Connection& connection = connections_[index];
+            const std::uint32_t sequence = sequence_of(
+                connection.word.load(std::memory_order_relaxed));
+            connection.word.store(pack(sequence, kConnecting),
+                                  std::memory_order_relaxed);
+
+            const bool started = server_->connect(
+                ipaddr_.c_str(),
+                port_,
+                options_.timeouts,
+                [this, index, sequence, fn = std::move(callback)](
+                    ClientSessionType& session, int error) mutable {
+                    connected(index, sequence, session, error, fn);
+                });
+
+            if (!started) {
+                connection.word.store(pack(sequence, kFree),
+                                      std::memory_order_relaxed);
+                connect_failure_count_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            return started;
+        }
+
+        /* @helper */
+        void connected(int index,
+                       std::uint32_t sequence,
+                       ClientSessionType& session,
+                       int error,
+                       LeaseCallback& callback)
+        {
+            Connection& connection = connections_[index];
+
+            if (error != 0) {
+                connect_failure_count_.fetch_add(1, std::memory_order_relaxed);
+                connection.word.store(pack(sequence, kClosed),
+                                      std::memory_order_release);
+                callback(session, UpstreamLease(), error);
+                return;
+            }
+
+            connection.session = session;
+            connection.idle_since.store(0, std::memory_order_relaxed);
+            session.set_event_handler(&connection);
+            if (options_.health_interval > 0) {
+                session.run_every(
+                    std::chrono::milliseconds(options_.health_interval),
+                    [this, index](ClientSessionType& client) {
+                        check(index, client);
+                    });
+            }
+
+            // Leased by the caller that opened it
+            connection.word.store(pack(sequence, 1), std::memory_order_release);
+            connect_count_.fetch_add(1, std::memory_order_relaxed);
+            lease_count_.fetch_add(1, std::memory_order_relaxed);
+            callback(session, UpstreamLease{index, sequence}, 0);
+        }
+
+        /* @helper */
+        void check(int index, ClientSessionType& session)
+        {
+            Connection& connection = connections_[index];
+
+            // Leased connections are checked by their use
+            std::uint64_t word
+                = connection.word.load(std::memory_order_acquire);
+            if (state_of(word) != 0
+                || !connection.word.compare_exchange_strong(
+                    word,
+                    pack(sequence_of(word), kChecking),
+                    std::memory_order_acq_rel)) {
+                return;
+            }
+
+            const std::int64_t idle_since
+                = connection.idle_since.load(std::memory_order_relaxed);
+            const bool expired
+                = options_.idle_timeout > 0 && idle_since != 0
+                  && util::CoarseClock::now_ms() - idle_since
+                         >= options_.idle_timeout;
+
+            if (!expired && session.peer_open()) {
+                connection.word.store(word, std::memory_order_release);
+                return;
+            }
+
+            // Left checking, so that no lease is granted, until the client
+            // closes
+            health_close_count_.fetch_add(1, std::memory_order_relaxed);
+            session.terminate();
+        }
+    };
+} // namespace fserv
@@ -0,0 +1,103 @@
+/* zerocopy_receive.hpp -- v1.0
+   TCP receive by page remapping (TCP_ZEROCOPY_RECEIVE) backend */
+
+#pragma once
+
+#include "memory_util.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+namespace fserv::util {
+
+    //! @struct ZeroCopyRegion
+    /*! Address range mapped on a TCP socket, into which received pages are
+     *! remapped instead of copied
+     */
+    struct ZeroCopyRegion {
+        char* ptr_to_mem = nullptr;
+        int capacity = 0;
+    };
+
+    /*! @brief Checks if memory is allocated.
+     */
+    inline bool is_allocated(const ZeroCopyRegion& region)
+    {
+        return region.ptr_to_mem != nullptr;
+    }
+
+    /*! @brief Maps passed region on a TCP socket, padded to page boundary.
+     */
+    inline bool init(ZeroCopyRegion& region, int sfd, int size_hint)
+    {
+        if (is_allocated(region)) {
+            return true;
+        }
+
+        const std::size_t size = padd_to_page_boundary(size_hint);
+
+        void* mem = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, sfd, 0);
+        if (mem == MAP_FAILED) {
+            return false;
+        }
+
+        region.ptr_to_mem = static_cast<char*>(mem);
+        region.capacity = static_cast<int>(size);
+
+        return true;
+    }
+
+    /*! @brief Unmaps region.
+     */
+    inline void destroy(ZeroCopyRegion& region)
+    {
+        if (is_allocated(region)) {
+            ::munmap(region.ptr_to_mem, region.capacity);
+            region = ZeroCopyRegion();
+        }
+    }
+
+    /*! @brief Drops the pages mapped into the region.
+     */
+    inline void release(ZeroCopyRegion& region, int size)
+    {
+        if (is_allocated(region) && size > 0) {
+            ::madvise(region.ptr_to_mem,
+                      padd_to_page_boundary(size),
+                      MADV_DONTNEED);
+        }
+    }
+
+    //! Maps whole received pages into the region.
+    //! Pages previously mapped into the region are replaced.
+    //! @param sfd
+    //!     Socket file descriptor
+    //! @param region
+    //!     Region mapped on the socket
+    //! @param copy_hint[out]
+    //!     Number of bytes that must be read by copy before further pages
+    //!     can be mapped
+    //! @return
+    //!     Number of bytes mapped at the start of the region, -1 on error
+    inline int endpoint_read_zerocopy(int sfd,
+                                      const ZeroCopyRegion& region,
+                                      int* copy_hint)
+    {
+        struct tcp_zerocopy_receive zc = {};
+        socklen_t zc_len = sizeof(zc);
+
+        zc.address = reinterpret_cast<std::uintptr_t>(region.ptr_to_mem);
+        zc.length = region.capacity;
+
+        if (::getsockopt(sfd, IPPROTO_TCP, TCP_ZEROCOPY_RECEIVE, &zc, &zc_len)
+            == -1) {
+            return -1;
+        }
+
+        *copy_hint = static_cast<int>(zc.recv_skip_hint);
+        return static_cast<int>(zc.length);
+    }
+} // namespace fserv::util
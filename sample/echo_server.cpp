@@ -4,6 +4,7 @@
 #include "echo_server_impl.hpp"
 #include "fserv/basic_client.hpp"
 #include "fserv/basic_server.hpp"
+#include "fserv/mutex.hpp"
 #include <mutex>
 #include <set>
 
@@ -37,7 +38,7 @@ private:
      */
     void handle_new_client(ClientSessionType& client)
     {
-        std::lock_guard<std::mutex> l(callback_access_lock_);
+        std::lock_guard<fserv::util::Mutex> l(callback_access_lock_);
         impl::handle_new_echo_client(client, active_sessions_, &stats_);
     }
 
@@ -45,7 +46,7 @@ private:
      */
     void handle_client_error(ClientSessionType& client)
     {
-        std::lock_guard<std::mutex> l(callback_access_lock_);
+        std::lock_guard<fserv::util::Mutex> l(callback_access_lock_);
         impl::handle_echo_client_error(client, active_sessions_, &stats_);
     }
 
@@ -53,7 +54,7 @@ private:
      */
     void handle_client_closed(ClientSessionType& client)
     {
-        std::lock_guard<std::mutex> l(callback_access_lock_);
+        std::lock_guard<fserv::util::Mutex> l(callback_access_lock_);
         impl::handle_echo_client_closed(client, active_sessions_, &stats_);
     }
 
@@ -63,7 +64,7 @@ private:
                                      const char* data,
                                      const int size)
     {
-        std::lock_guard<std::mutex> l(callback_access_lock_);
+        std::lock_guard<fserv::util::Mutex> l(callback_access_lock_);
         impl::handle_echo_client_data_received(
             client, data, size, active_sessions_, &stats_);
     }
@@ -72,7 +73,8 @@ private:
     impl::Stats stats_;
 
     /* Primary access lock */
-    std::mutex callback_access_lock_;
+    fserv::util::Mutex callback_access_lock_{
+        "EchoServer::callback_access_lock_"};
 
     /* Server backend instance */
     fserv::BasicServer<fserv::BasicClient> server_;
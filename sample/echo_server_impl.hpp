@@ -4,6 +4,7 @@
 #pragma once
 
 #include "fserv/client_session.hpp"
+#include "fserv/mutex.hpp"
 #include <cstdio>
 #include <mutex>
 #include <ncurses.h>
@@ -28,7 +29,7 @@ namespace app::impl {
         //!     Number of errors to add
         void add_err(int n)
         {
-            std::lock_guard<std::mutex> l(access_lock_);
+            std::lock_guard<fserv::util::Mutex> l(access_lock_);
             err_ += n;
             print();
         }
@@ -38,7 +39,7 @@ namespace app::impl {
         //!     Number of received messages to add
         void add_rx(int n)
         {
-            std::lock_guard<std::mutex> l(access_lock_);
+            std::lock_guard<fserv::util::Mutex> l(access_lock_);
             rx_ += n;
             print();
         }
@@ -48,7 +49,7 @@ namespace app::impl {
         //!     Number of sent replies to add
         void add_tx(int n)
         {
-            std::lock_guard<std::mutex> l(access_lock_);
+            std::lock_guard<fserv::util::Mutex> l(access_lock_);
             tx_ += n;
             print();
         }
@@ -58,7 +59,7 @@ namespace app::impl {
         //!     Number of clients
         void set_clients(int n)
         {
-            std::lock_guard<std::mutex> l(access_lock_);
+            std::lock_guard<fserv::util::Mutex> l(access_lock_);
             clients_ = n;
             print();
         }
@@ -74,7 +75,7 @@ namespace app::impl {
         /* Line number in ncurses window of output line */
         int line_ = 0;
         /* Primary access lock */
-        std::mutex access_lock_;
+        fserv::util::Mutex access_lock_{"Stats::access_lock_"};
 
         //! Helper function to print stats to ncurses window.
         void print() const